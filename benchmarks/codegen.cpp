@@ -0,0 +1,148 @@
+/**
+ * Code generation benchmark: ensureExists() and rebuild() on a renderer-like
+ * graph, next to the sequence one would write by hand. codegen.py compiles
+ * this file with optimizations and compares the disassembly of each pair of
+ * functions (library_* vs reference_*).
+ *
+ * Create/Destroy/Exists callbacks are only declared, so that the compiler
+ * cannot inline them and each function reduces to the sequence of checks and
+ * calls that the graph algorithms generate.
+ */
+#include <statdeps/statdeps.hpp>
+
+struct Renderer {
+	void createDevice();
+	void destroyDevice();
+	bool deviceReady = false;
+
+	void createLayouts();
+	void destroyLayouts();
+	bool layoutsReady = false;
+
+	void createPipeline();
+	void destroyPipeline();
+	bool pipelineReady = false;
+
+	void createTextures();
+	void destroyTextures();
+	bool texturesReady = false;
+
+	void createViews();
+	void destroyViews();
+	bool viewsReady = false;
+
+	// This one manages its own state
+	void createSampler();
+	void destroySampler();
+	bool samplerExists() const;
+
+	void createBindGroups();
+	void destroyBindGroups();
+	bool bindGroupsReady = false;
+
+	void createRenderLoop();
+	void destroyRenderLoop();
+	bool renderLoopReady = false;
+
+	using Builder = statdeps::DepsNodeBuilder::with_context<Renderer>;
+	using Device = Builder::with_create<&Renderer::createDevice>::with_destroy<&Renderer::destroyDevice>::with_ready_state<&Renderer::deviceReady>::build;
+	using Layouts = Builder::with_create<&Renderer::createLayouts>::with_destroy<&Renderer::destroyLayouts>::with_ready_state<&Renderer::layoutsReady>::build;
+	using Pipeline = Builder::with_create<&Renderer::createPipeline>::with_destroy<&Renderer::destroyPipeline>::with_ready_state<&Renderer::pipelineReady>::build;
+	using Textures = Builder::with_create<&Renderer::createTextures>::with_destroy<&Renderer::destroyTextures>::with_ready_state<&Renderer::texturesReady>::build;
+	using Views = Builder::with_create<&Renderer::createViews>::with_destroy<&Renderer::destroyViews>::with_ready_state<&Renderer::viewsReady>::build;
+	using Sampler = Builder::with_create<&Renderer::createSampler>::with_destroy<&Renderer::destroySampler>::with_exists<&Renderer::samplerExists>::build;
+	using BindGroups = Builder::with_create<&Renderer::createBindGroups>::with_destroy<&Renderer::destroyBindGroups>::with_ready_state<&Renderer::bindGroupsReady>::build;
+	using RenderLoop = Builder::with_create<&Renderer::createRenderLoop>::with_destroy<&Renderer::destroyRenderLoop>::with_ready_state<&Renderer::renderLoopReady>::build;
+
+	using Graph = statdeps::DepsGraph<
+		statdeps::List<>,
+		statdeps::List<
+			statdeps::DepsEdge<Layouts, Device>,
+			statdeps::DepsEdge<Pipeline, Layouts>,
+			statdeps::DepsEdge<Textures, Device>,
+			statdeps::DepsEdge<Views, Textures>,
+			statdeps::DepsEdge<Sampler, Device>,
+			statdeps::DepsEdge<BindGroups, Layouts>,
+			statdeps::DepsEdge<BindGroups, Views>,
+			statdeps::DepsEdge<BindGroups, Sampler>,
+			statdeps::DepsEdge<RenderLoop, Pipeline>,
+			statdeps::DepsEdge<RenderLoop, BindGroups>
+		>
+	>;
+};
+
+#define BENCHMARK_FUNCTION extern "C" __attribute__((noinline))
+
+BENCHMARK_FUNCTION void library_ensureExists(Renderer& r) {
+	statdeps::ensureExists(r, Renderer::RenderLoop{}, Renderer::Graph{});
+}
+
+BENCHMARK_FUNCTION void reference_ensureExists(Renderer& r) {
+	if (!r.deviceReady) { r.createDevice(); r.deviceReady = true; }
+	if (!r.layoutsReady) { r.createLayouts(); r.layoutsReady = true; }
+	if (!r.texturesReady) { r.createTextures(); r.texturesReady = true; }
+	if (!r.samplerExists()) { r.createSampler(); }
+	if (!r.pipelineReady) { r.createPipeline(); r.pipelineReady = true; }
+	if (!r.viewsReady) { r.createViews(); r.viewsReady = true; }
+	if (!r.bindGroupsReady) { r.createBindGroups(); r.bindGroupsReady = true; }
+	if (!r.renderLoopReady) { r.createRenderLoop(); r.renderLoopReady = true; }
+}
+
+BENCHMARK_FUNCTION void library_rebuildLayouts(Renderer& r) {
+	statdeps::rebuild(r, Renderer::Layouts{}, Renderer::Graph{});
+}
+
+BENCHMARK_FUNCTION void reference_rebuildLayouts(Renderer& r) {
+	bool pipeline = r.pipelineReady;
+	bool bindGroups = r.bindGroupsReady;
+	bool renderLoop = r.renderLoopReady;
+	if (renderLoop) { r.destroyRenderLoop(); r.renderLoopReady = false; }
+	if (bindGroups) { r.destroyBindGroups(); r.bindGroupsReady = false; }
+	if (pipeline) { r.destroyPipeline(); r.pipelineReady = false; }
+	if (r.layoutsReady) { r.destroyLayouts(); r.layoutsReady = false; }
+	r.createLayouts(); r.layoutsReady = true;
+	if (pipeline) { r.createPipeline(); r.pipelineReady = true; }
+	if (bindGroups) { r.createBindGroups(); r.bindGroupsReady = true; }
+	if (renderLoop) { r.createRenderLoop(); r.renderLoopReady = true; }
+}
+
+BENCHMARK_FUNCTION void library_rebuildTextures(Renderer& r) {
+	statdeps::rebuild(r, Renderer::Textures{}, Renderer::Graph{});
+}
+
+BENCHMARK_FUNCTION void reference_rebuildTextures(Renderer& r) {
+	bool views = r.viewsReady;
+	bool bindGroups = r.bindGroupsReady;
+	bool renderLoop = r.renderLoopReady;
+	if (renderLoop) { r.destroyRenderLoop(); r.renderLoopReady = false; }
+	if (bindGroups) { r.destroyBindGroups(); r.bindGroupsReady = false; }
+	if (views) { r.destroyViews(); r.viewsReady = false; }
+	if (r.texturesReady) { r.destroyTextures(); r.texturesReady = false; }
+	r.createTextures(); r.texturesReady = true;
+	if (views) { r.createViews(); r.viewsReady = true; }
+	if (bindGroups) { r.createBindGroups(); r.bindGroupsReady = true; }
+	if (renderLoop) { r.createRenderLoop(); r.renderLoopReady = true; }
+}
+
+BENCHMARK_FUNCTION void library_rebuildLayoutsAndTextures(Renderer& r) {
+	statdeps::rebuild(r, statdeps::List<Renderer::Layouts, Renderer::Textures>{}, Renderer::Graph{});
+}
+
+BENCHMARK_FUNCTION void reference_rebuildLayoutsAndTextures(Renderer& r) {
+	bool pipeline = r.pipelineReady;
+	bool views = r.viewsReady;
+	bool bindGroups = r.bindGroupsReady;
+	bool renderLoop = r.renderLoopReady;
+	if (renderLoop) { r.destroyRenderLoop(); r.renderLoopReady = false; }
+	if (bindGroups) { r.destroyBindGroups(); r.bindGroupsReady = false; }
+	if (views) { r.destroyViews(); r.viewsReady = false; }
+	if (pipeline) { r.destroyPipeline(); r.pipelineReady = false; }
+	if (r.texturesReady) { r.destroyTextures(); r.texturesReady = false; }
+	if (r.layoutsReady) { r.destroyLayouts(); r.layoutsReady = false; }
+	r.createLayouts(); r.layoutsReady = true;
+	r.createTextures(); r.texturesReady = true;
+	if (pipeline) { r.createPipeline(); r.pipelineReady = true; }
+	if (views) { r.createViews(); r.viewsReady = true; }
+	if (bindGroups) { r.createBindGroups(); r.bindGroupsReady = true; }
+	if (renderLoop) { r.createRenderLoop(); r.renderLoopReady = true; }
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Compile codegen.cpp with optimizations and compare, for each library_<name>
+function, its disassembly with the hand-written reference_<name> one. The
+comparison counts instructions, conditional branches and calls (padding
+instructions are ignored).
+
+Exits with a non-zero status if a library function has more conditional
+branches or calls than its reference, which means that the graph algorithms
+introduced some overhead (extra branches, duplicate ready state checks,
+calls that could have been resolved at compile time, etc.), or more
+instructions beyond a small tolerance (the compiler may lay out equivalent
+code a bit differently).
+
+Example:
+    python3 codegen.py --cxx g++ -I ../include codegen.cpp
+"""
+
+import argparse
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+
+FUNCTION_RE = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+PADDING = {"nop", "nopw", "nopl", "xchg", "int3"}
+
+
+def disassemble(objdump, obj):
+    output = subprocess.run([objdump, "-d", "--no-show-raw-insn", obj], capture_output=True, text=True, check=True).stdout
+    functions = {}
+    current = None
+    for line in output.splitlines():
+        match = FUNCTION_RE.match(line)
+        if match:
+            current = functions.setdefault(match.group(1), [])
+        elif current is not None and "\t" in line:
+            mnemonic = line.split("\t")[-1].split()[0] if line.split("\t")[-1].split() else ""
+            if mnemonic and mnemonic not in PADDING:
+                current.append(mnemonic)
+    return functions
+
+
+def statistics(instructions):
+    return {
+        "instructions": len(instructions),
+        "branches": sum(1 for i in instructions if i.startswith("j") and i != "jmp"),
+        "calls": sum(1 for i in instructions if i.startswith("call")),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--objdump", default="objdump")
+    parser.add_argument("--std", default="17")
+    parser.add_argument("--opt", default="-O2")
+    parser.add_argument("-I", "--include", action="append", default=[])
+    parser.add_argument("--tolerance", type=float, default=0.05,
+                        help="Relative excess of instructions that is allowed (default: 0.05)")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        obj = os.path.join(tmp, "codegen.o")
+        command = [args.cxx, "-std=c++" + args.std, args.opt] + sum((["-I", d] for d in args.include), []) + ["-c", args.source, "-o", obj]
+        if subprocess.run(command).returncode != 0:
+            sys.exit(f"Compilation failed: {shlex.join(command)}")
+        functions = disassemble(args.objdump, obj)
+
+    names = sorted(f[len("library_"):] for f in functions if f.startswith("library_"))
+    if not names:
+        sys.exit("No library_* function found")
+
+    failed = False
+    print(f"{'function':<20} | {'metric':<12} | library | reference")
+    print("-" * 20 + "-+-" + "-" * 12 + "-+---------+----------")
+    for name in names:
+        library = statistics(functions["library_" + name])
+        reference = statistics(functions.get("reference_" + name, []))
+        for metric in library:
+            mark = ""
+            allowed = reference[metric] * (1 + args.tolerance) if metric == "instructions" else reference[metric]
+            if library[metric] > allowed:
+                mark = "  <-- overhead"
+                failed = True
+            print(f"{name:<20} | {metric:<12} | {library[metric]:<7} | {reference[metric]}{mark}")
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+Measure the cost of compiling a benchmark source file, for several variants
+of preprocessor definitions. For each variant, this reports the compilation
+wall time, the peak memory of the compiler process, the size of the object
+file and the number of function template instantiations, estimated as the
+number of functions defined in the object file when compiled without
+optimization (they are then not inlined away, so this is only reported with
+--opt=-O0).
+
+With --run, the object is also linked and executed, the size of the binary is
+reported and every "key: value" line printed by the benchmark is added as an
+extra column.
+
+Examples:
+    python3 compile_time.py --cxx g++ -I ../include list_operations.cpp \\
+        --variant recursive=-DSTATDEPS_BENCHMARK_RECURSIVE --variant fold=
+
+    python3 compile_time.py --cxx g++ -I ../include graph_benchmark.cpp --opt=-O2 --run \\
+        --variant "chain=-DSTATDEPS_BENCHMARK_SHAPE=Chain -DSTATDEPS_BENCHMARK_SIZE=512"
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def compile_once(cxx, flags, source, output):
+    command = [cxx] + flags + ["-c", source, "-o", output]
+    start = time.perf_counter()
+    process = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    _, status, usage = os.wait4(process.pid, 0)
+    elapsed = time.perf_counter() - start
+    stderr = process.stderr.read().decode(errors="replace")
+    process.stdout.close()
+    process.stderr.close()
+    process.returncode = os.waitstatus_to_exitcode(status)
+    if process.returncode != 0:
+        sys.exit(f"Compilation failed: {shlex.join(command)}\n{stderr}")
+    # ru_maxrss is in kilobytes on Linux
+    return elapsed, usage.ru_maxrss * 1024
+
+
+def count_functions(nm, obj):
+    output = subprocess.run([nm, "--defined-only", obj], capture_output=True, text=True, check=True).stdout
+    return sum(1 for line in output.splitlines() if line.split()[1:2] and line.split()[1] in "TtWw")
+
+
+def link_and_run(cxx, obj, exe):
+    subprocess.run([cxx, obj, "-o", exe], check=True)
+    output = subprocess.run([exe], capture_output=True, text=True, check=True).stdout
+    results = {"binary size (kB)": f"{os.path.getsize(exe) / 1024:.1f}"}
+    for line in output.splitlines():
+        key, sep, value = line.partition(":")
+        if sep:
+            results[key.strip()] = value.strip()
+    return results
+
+
+def measure(args, name, defines):
+    flags = ["-std=c++" + args.std] + sum((["-I", d] for d in args.include), []) + shlex.split(defines)
+    with tempfile.TemporaryDirectory() as tmp:
+        obj = os.path.join(tmp, "bench.o")
+        times = []
+        memory = 0
+        for _ in range(args.runs):
+            elapsed, peak = compile_once(args.cxx, flags + [args.opt] + args.extra, args.source, obj)
+            times.append(elapsed)
+            memory = max(memory, peak)
+        row = {
+            "variant": name,
+            "time (s)": f"{min(times):.2f}",
+            "peak memory (MB)": f"{memory / 2**20:.1f}",
+            "object size (kB)": f"{os.path.getsize(obj) / 1024:.1f}",
+        }
+        if args.opt == "-O0":
+            row["functions"] = str(count_functions(args.nm, obj))
+        if args.run:
+            row.update(link_and_run(args.cxx, obj, os.path.join(tmp, "bench")))
+    return row
+
+
+def print_table(rows):
+    columns = list(dict.fromkeys(c for r in rows for c in r))
+    widths = [max(len(c), *(len(r.get(c, "")) for r in rows)) for c in columns]
+    print(" | ".join(c.ljust(w) for c, w in zip(columns, widths)))
+    print("-+-".join("-" * w for w in widths))
+    for row in rows:
+        print(" | ".join(row.get(c, "").ljust(w) for c, w in zip(columns, widths)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--nm", default="nm")
+    parser.add_argument("--std", default="17")
+    parser.add_argument("-I", "--include", action="append", default=[])
+    parser.add_argument("--variant", action="append", default=[],
+                        help="NAME=DEFINES, may be repeated (default: a single variant with no define)")
+    parser.add_argument("--extra", action="append", default=[], help="Extra compiler flag, may be repeated")
+    parser.add_argument("--runs", type=int, default=3, help="Number of compilations per variant, the fastest is kept")
+    parser.add_argument("--opt", default="-O0", help="Optimization flag (default: -O0)")
+    parser.add_argument("--run", action="store_true", help="Also link and run the benchmark")
+    args = parser.parse_args()
+
+    variants = [v.split("=", 1) if "=" in v else (v, "") for v in args.variant] or [("default", "")]
+    print_table([measure(args, name, defines) for name, defines in variants])
+
+
+if __name__ == "__main__":
+    main()
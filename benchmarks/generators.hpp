@@ -0,0 +1,128 @@
+/*
+ * Synthetic dependency graphs of configurable shape and size, used by the
+ * benchmarks. Every node has a create/destroy callback that only increments
+ * a counter, and its own ready state, so that measures focus on the overhead
+ * of the graph algorithms themselves.
+ */
+
+#pragma once
+
+#include <statdeps/statdeps.hpp>
+
+#include <cstddef>
+#include <utility>
+
+namespace bench {
+
+using statdeps::List;
+using statdeps::DepsEdge;
+using statdeps::DepsGraph;
+
+inline std::size_t createCount = 0;
+inline std::size_t destroyCount = 0;
+
+template <int N>
+bool readyState = false;
+
+template <int N>
+void create() { ++createCount; }
+
+template <int N>
+void destroy() { ++destroyCount; }
+
+template <int N>
+using Node = typename statdeps::DepsNodeBuilder
+	::with_identifier<N>
+	::template with_create<&create<N>>
+	::template with_destroy<&destroy<N>>
+	::template with_ready_state<&readyState<N>>
+	::build;
+
+/**
+ * Each shape exposes its Graph, a Source node on which (almost) everything
+ * depends, and a Sink node that depends on (almost) everything.
+ */
+
+// Node<I + 1> depends on Node<I>
+template <std::size_t Length>
+struct Chain {
+	template <std::size_t... Is>
+	static auto edges(std::index_sequence<Is...>) -> List<DepsEdge<Node<Is + 1>, Node<Is>>...>;
+
+	using Graph = DepsGraph<List<>, decltype(edges(std::make_index_sequence<Length>{}))>;
+	using Source = Node<0>;
+	using Sink = Node<Length>;
+};
+
+// Width independent nodes that all depend on Node<0>, and on which the last
+// node depends.
+template <std::size_t Width>
+struct Wide {
+	template <std::size_t... Is>
+	static auto edges(std::index_sequence<Is...>) -> decltype(statdeps::concat(
+		List<DepsEdge<Node<Is + 1>, Node<0>>...>{},
+		List<DepsEdge<Node<Width + 1>, Node<Is + 1>>...>{}
+	));
+
+	using Graph = DepsGraph<List<>, decltype(edges(std::make_index_sequence<Width>{}))>;
+	using Source = Node<0>;
+	using Sink = Node<Width + 1>;
+};
+
+// A sequence of diamonds: Node<3k+1> and Node<3k+2> depend on Node<3k> and
+// Node<3k+3> depends on both of them. The number of paths from source to sink
+// is 2^Depth.
+template <std::size_t Depth>
+struct Diamonds {
+	template <std::size_t... Ks>
+	static auto edges(std::index_sequence<Ks...>) -> decltype(statdeps::concat(
+		statdeps::concat(
+			List<DepsEdge<Node<3 * Ks + 1>, Node<3 * Ks>>...>{},
+			List<DepsEdge<Node<3 * Ks + 2>, Node<3 * Ks>>...>{}
+		),
+		statdeps::concat(
+			List<DepsEdge<Node<3 * Ks + 3>, Node<3 * Ks + 1>>...>{},
+			List<DepsEdge<Node<3 * Ks + 3>, Node<3 * Ks + 2>>...>{}
+		)
+	));
+
+	using Graph = DepsGraph<List<>, decltype(edges(std::make_index_sequence<Depth>{}))>;
+	using Source = Node<0>;
+	using Sink = Node<3 * Depth>;
+};
+
+// Layers of Width nodes, roughly shaped like a renderer: every node of
+// layer 0 depends on a "device" Node<0>, each node of the other layers depends
+// on two nodes of the previous layer, and a final "render loop" node depends on
+// the whole last layer.
+template <std::size_t Layers, std::size_t Width>
+struct Layered {
+	static_assert(Layers >= 1 && Width >= 1);
+
+	// Index of the j-th node of a layer (wrapping around the layer width)
+	static constexpr int id(std::size_t layer, std::size_t j) {
+		return static_cast<int>(1 + layer * Width + j % Width);
+	}
+
+	template <std::size_t... Js>
+	static auto outerEdges(std::index_sequence<Js...>) -> decltype(statdeps::concat(
+		List<DepsEdge<Node<id(0, Js)>, Node<0>>...>{},
+		List<DepsEdge<Node<id(Layers, 0)>, Node<id(Layers - 1, Js)>>...>{}
+	));
+
+	// Is enumerates all nodes but the ones of the last layer
+	template <std::size_t... Is>
+	static auto innerEdges(std::index_sequence<Is...>) -> decltype(statdeps::concat(
+		List<DepsEdge<Node<id(Is / Width + 1, Is)>, Node<id(Is / Width, Is)>>...>{},
+		List<DepsEdge<Node<id(Is / Width + 1, Is)>, Node<id(Is / Width, Is + 1)>>...>{}
+	));
+
+	using Graph = DepsGraph<List<>, decltype(statdeps::concat(
+		decltype(outerEdges(std::make_index_sequence<Width>{})){},
+		decltype(innerEdges(std::make_index_sequence<(Layers - 1) * Width>{})){}
+	))>;
+	using Source = Node<0>;
+	using Sink = Node<id(Layers, 0)>;
+};
+
+} // namespace bench
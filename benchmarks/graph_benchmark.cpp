@@ -0,0 +1,76 @@
+/**
+ * Runtime benchmark of ensureExists() and rebuild() on a synthetic graph,
+ * whose shape and size are selected at compile time with:
+ *
+ *   STATDEPS_BENCHMARK_SHAPE: Chain, Wide, Diamonds or Layered (see generators.hpp)
+ *   STATDEPS_BENCHMARK_SIZE: length, width, depth or number of layers
+ *
+ * Results are printed as "key: value" lines, which compile_time.py --run
+ * collects as extra columns.
+ */
+#include "generators.hpp"
+
+#include <statdeps/statdeps.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#ifndef STATDEPS_BENCHMARK_SHAPE
+#define STATDEPS_BENCHMARK_SHAPE Layered
+#endif
+
+#ifndef STATDEPS_BENCHMARK_SIZE
+#define STATDEPS_BENCHMARK_SIZE 64
+#endif
+
+#ifndef STATDEPS_BENCHMARK_ITERATIONS
+#define STATDEPS_BENCHMARK_ITERATIONS 10000
+#endif
+
+// Layered uses a fixed width of 8 nodes per layer
+template <template <std::size_t, std::size_t> class Shape, std::size_t Size>
+Shape<Size, 8> selectShape();
+template <template <std::size_t> class Shape, std::size_t Size>
+Shape<Size> selectShape();
+
+using Shape = decltype(selectShape<bench::STATDEPS_BENCHMARK_SHAPE, STATDEPS_BENCHMARK_SIZE>());
+using Graph = Shape::Graph;
+using Tables = Graph::Tables;
+
+static statdeps::NoContext ctx;
+
+template <std::size_t... Is>
+void resetAll(std::index_sequence<Is...>) {
+	((Tables::NodeAt<Is>::ReadyState(ctx) = false), ...);
+}
+
+template <typename Lambda>
+double nanosecondsPerCall(Lambda&& lambda, bool resetBefore) {
+	using Clock = std::chrono::steady_clock;
+	Clock::duration total{};
+	for (int i = 0; i < STATDEPS_BENCHMARK_ITERATIONS; ++i) {
+		if (resetBefore) resetAll(std::make_index_sequence<Tables::NodeCount>{});
+		auto start = Clock::now();
+		lambda();
+		total += Clock::now() - start;
+	}
+	return std::chrono::duration<double, std::nano>(total).count() / STATDEPS_BENCHMARK_ITERATIONS;
+}
+
+int main(int, char**) {
+	std::printf("nodes: %zu\n", Tables::NodeCount);
+	std::printf("edges: %zu\n", Tables::EdgeCount);
+
+	double cold = nanosecondsPerCall([] { statdeps::ensureExists(ctx, Shape::Sink{}, Graph{}); }, true);
+	std::printf("ensureExists cold (ns): %.1f\n", cold);
+
+	double warm = nanosecondsPerCall([] { statdeps::ensureExists(ctx, Shape::Sink{}, Graph{}); }, false);
+	std::printf("ensureExists warm (ns): %.1f\n", warm);
+
+	bench::createCount = 0;
+	double rebuild = nanosecondsPerCall([] { statdeps::rebuild(ctx, Shape::Source{}, Graph{}); }, false);
+	std::printf("rebuild (ns): %.1f\n", rebuild);
+	std::printf("creates per rebuild: %zu\n", bench::createCount / STATDEPS_BENCHMARK_ITERATIONS);
+	return 0;
+}
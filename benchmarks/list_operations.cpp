@@ -0,0 +1,76 @@
+/**
+ * Compile-time benchmark of the list operations (forEach, revert, concat) on
+ * the dependee list of a long chain of nodes.
+ *
+ * When STATDEPS_BENCHMARK_RECURSIVE is defined, the list operations are
+ * replaced by the reference implementations below, which recurse once per
+ * element like the library used to, in order to compare both approaches with
+ * compile_time.py.
+ */
+#include <statdeps/statdeps.hpp>
+
+#include <cstdio>
+#include <utility>
+
+#ifndef STATDEPS_BENCHMARK_SIZE
+#define STATDEPS_BENCHMARK_SIZE 512
+#endif
+
+namespace reference {
+
+using statdeps::List;
+
+template <typename FirstItem, typename... OtherItems, typename Lambda>
+constexpr void forEach(List<FirstItem, OtherItems...>, Lambda lambda) noexcept {
+	lambda(FirstItem{});
+	forEach(List<OtherItems...>{}, lambda);
+}
+
+template <typename Lambda>
+constexpr void forEach(List<>, Lambda) noexcept {
+}
+
+template <typename... Items, typename... OtherItems>
+constexpr auto concat(List<Items...>, List<OtherItems...>) noexcept {
+	return List<Items..., OtherItems...>{};
+}
+
+constexpr auto revert(List<>) noexcept {
+	return List<>{};
+}
+
+template <typename FirstItem, typename... Items>
+constexpr auto revert(List<FirstItem, Items...>) noexcept {
+	return statdeps::append(revert(List<Items...>{}), FirstItem{});
+}
+
+} // namespace reference
+
+#ifdef STATDEPS_BENCHMARK_RECURSIVE
+namespace ops = reference;
+#else
+namespace ops = statdeps;
+#endif
+
+template <int N>
+using Node = typename statdeps::DepsNodeBuilder::with_identifier<N>::build;
+
+// Node<I + 1> depends on Node<I>
+template <std::size_t... Is>
+auto makeChain(std::index_sequence<Is...>) -> statdeps::List<statdeps::DepsEdge<Node<Is + 1>, Node<Is>>...>;
+
+using Graph = statdeps::DepsGraph<
+	statdeps::List<>,
+	decltype(makeChain(std::make_index_sequence<STATDEPS_BENCHMARK_SIZE>{}))
+>;
+
+int main(int, char**) {
+	using Dependees = decltype(statdeps::allDependees(Node<0>{}, Graph{}));
+	using Reverted = decltype(ops::revert(Dependees{}));
+	using Both = decltype(ops::concat(Dependees{}, Reverted{}));
+
+	int sum = 0;
+	ops::forEach(Both{}, [&sum](auto node) { sum += decltype(node)::Identifier; });
+	std::printf("%d\n", sum);
+	return 0;
+}
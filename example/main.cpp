@@ -1,9 +1,14 @@
 #include "mock-types.h"
 
 #include <statdeps/statdeps.hpp>
+#include <statdeps/parallel.hpp>
+#include <statdeps/export.hpp>
 
+#include <chrono>
 #include <string>
+#include <cstdint>
 #include <vector>
+#include <utility>
 #include <iostream>
 #include <functional>
 
@@ -15,7 +20,7 @@ class Application {
 public:
 	/**
 	 * Make sure that everything we need is initialized, namely in this example
-	 * the textureView supposedly used for rendering.
+	 * the bind group supposedly used for rendering.
 	 */
 	void onInit();
 
@@ -26,38 +31,60 @@ public:
 	void onGui();
 
 private:
+	/**
+	 * The output of DataResource, which is moved into m_image rather than
+	 * copied when the file is read.
+	 */
+	struct ImageData {
+		std::vector<uint8_t> pixels;
+		glm::uvec2 size;
+	};
+
 	std::string m_path = "some/file.jpg";
-	glm::uvec2 m_size;
-	std::vector<uint8_t> m_data;
+	ImageData m_image;
 	bool m_dataReady = false;
 	wgpu::Texture m_texture;
 	bool m_textureReady = false;
 	wgpu::TextureView m_textureView;
 	bool m_textureViewReady = false;
+	wgpu::BindGroup m_bindGroup;
+	// Packed ready states, for nodes that use with_ready_store
+	statdeps::ReadyStore<> m_readyStates;
 	bool m_fakeReady = false;
 
 public:
 	/**
 	 * The builder pattern allows to easily create an alias with some default
 	 * options, here we make sure all dependency nodes use the Application as
-	 * context.
+	 * context, and count how many times each of them is created (see main).
 	 */
-	using DepsNodeBuilder = statdeps::DepsNodeBuilder::with_context<Application>;
+	using DepsNodeBuilder = statdeps::DepsNodeBuilder
+		::with_context<Application>
+		::with_instrumentation<statdeps::CountingInstrumentation>;
 
 	/**
 	 * In the most simple case, a resource is just an abstract node in the
-	 * dependency graph.
+	 * dependency graph. Nodes are declared as structs that derive from the
+	 * built type rather than as aliases, so that they get their own name when
+	 * printing or exporting the graph (see main).
 	 */
-	using PathResource = DepsNodeBuilder::build;
+	struct PathResource : DepsNodeBuilder::build {};
 
-	void createData() {
+	ImageData loadData() {
 		auto [data, size] = readImageFile(m_path);
-		m_data = data;
-		m_size = size;
+		return { std::move(data), size };
 	}
 	void destroyData() {
 		std::cout << "Clear data" << std::endl;
-		m_data.clear();
+	}
+
+	std::uint64_t hashData() const {
+		// FNV-1a
+		std::uint64_t hash = 14695981039346656037ull;
+		for (uint8_t byte : m_image.pixels) {
+			hash = (hash ^ byte) * 1099511628211ull;
+		}
+		return hash;
 	}
 
 	/**
@@ -68,29 +95,48 @@ public:
 	 * resource has been created or not (alternatively, we can manage this
 	 * ourselves in create/destroy and provide a "exists" callback that tells
 	 * whether the resource is initialized).
+	 *
+	 * Rather than being created by a callback that sets m_image, the data is
+	 * the output of loadData(), which would be passed by const reference to the
+	 * producers of dependees that have an output too. It is reset when the
+	 * resource is destroyed.
+	 *
+	 * The fingerprint tells whether reloading the file actually changed the
+	 * data, and if not the texture is left untouched.
 	 */
-	using DataResource = DepsNodeBuilder
-		::with_create<&createData>
-		::with_destroy<&destroyData>
+	struct DataResource : DepsNodeBuilder
+		::with_output<&Application::m_image, &Application::loadData>
+		::with_destroy<&Application::destroyData>
 		::with_ready_state<&Application::m_dataReady>
-		::build;
+		::with_fingerprint<&Application::hashData>
+		::build {};
 
 	void createTextureA() {
-		m_texture = createTexture(m_size);
-		uploadData(m_texture, m_data);
+		m_texture = createTexture(m_image.size);
+		uploadData(m_texture, m_image.pixels);
 	}
 	void destroyTextureA() {
 		destroyTexture(m_texture);
 	}
+	bool updateTextureA() {
+		if (m_texture.size.x != m_image.size.x || m_texture.size.y != m_image.size.y) return false;
+		uploadData(m_texture, m_image.pixels);
+		return true;
+	}
 
 	/**
-	 * TODO: add a way not to reallocate the texture when the size did not change.
+	 * GPU calls must be issued from the main thread, so when initializing in
+	 * parallel (see onInit) only the data is read from a worker thread.
+	 * When the size did not change, rebuilding the data only uploads it to the
+	 * existing texture, and the view and bind group are kept.
 	 */
-	using TextureResource = DepsNodeBuilder
-		::with_create<&createTextureA>
-		::with_destroy<&destroyTextureA>
+	struct TextureResource : DepsNodeBuilder
+		::with_create<&Application::createTextureA>
+		::with_destroy<&Application::destroyTextureA>
+		::with_update<&Application::updateTextureA>
 		::with_ready_state<&Application::m_textureReady>
-		::build;
+		::with_main_thread
+		::build {};
 
 	void createTextureViewA() {
 		m_textureView = createTextureView(m_texture);
@@ -98,11 +144,25 @@ public:
 	void destroyTextureViewA() {
 		destroyTextureView(m_textureView);
 	}
-	using TextureViewResource = DepsNodeBuilder
-		::with_create<&createTextureViewA>
-		::with_destroy<&destroyTextureViewA>
+	struct TextureViewResource : DepsNodeBuilder
+		::with_create<&Application::createTextureViewA>
+		::with_destroy<&Application::destroyTextureViewA>
 		::with_ready_state<&Application::m_textureViewReady>
-		::build;
+		::with_main_thread
+		::build {};
+
+	void createBindGroupA() {
+		m_bindGroup = createBindGroup(m_texture, m_textureView);
+	}
+	void destroyBindGroupA() {
+		destroyBindGroup(m_bindGroup);
+	}
+	struct BindGroupResource : DepsNodeBuilder
+		::with_create<&Application::createBindGroupA>
+		::with_destroy<&Application::destroyBindGroupA>
+		::with_ready_store<&Application::m_readyStates>
+		::with_main_thread
+		::build {};
 
 	/**
 	 * In order to check that the automatic dependency update does not create
@@ -112,20 +172,23 @@ public:
 	void createFake() {
 		throw std::runtime_error("This resource should never get created because we don't ask for it");
 	}
-	using FakeResource = DepsNodeBuilder
-		::with_create<&createFake>
+	struct FakeResource : DepsNodeBuilder
+		::with_create<&Application::createFake>
 		::with_ready_state<&Application::m_fakeReady>
-		::build;
+		::build {};
 
 	/**
 	 * Finally we list the dependencies between nodes.
-	 * TODO: Make the example a bit more interesting, with diamond graph etc.
+	 * The bind group depends on both the texture and its view, which forms a
+	 * diamond: it must still be created and destroyed only once.
 	 */
 	using DepsLinks = statdeps::List<
 		// StaticDepsLink<A, B> means "A depends on B"
 		statdeps::DepsEdge<DataResource, PathResource>,
 		statdeps::DepsEdge<TextureResource, DataResource>,
 		statdeps::DepsEdge<TextureViewResource, TextureResource>,
+		statdeps::DepsEdge<BindGroupResource, TextureViewResource>,
+		statdeps::DepsEdge<BindGroupResource, TextureResource>,
 		statdeps::DepsEdge<FakeResource, TextureViewResource>
 	>;
 	using DepsGraph = statdeps::DepsGraph<statdeps::List<>, DepsLinks>;
@@ -136,18 +199,34 @@ public:
 	 */
 	template <typename DepsNode>
 	void ensureExists() { statdeps::ensureExists(*this, DepsNode{}, DepsGraph{}); }
-	template <typename DepsNode>
-	void rebuild() { statdeps::rebuild(*this, DepsNode{}, DepsGraph{}); }
+	template <typename... DepsNodes>
+	void rebuild() { statdeps::rebuild(*this, statdeps::List<DepsNodes...>{}, DepsGraph{}); }
+
+	/**
+	 * Nodes to rebuild at the end of the frame, e.g. PathResource is
+	 * invalidated at each keystroke but only rebuilt once per frame.
+	 */
+	statdeps::DirtySet<DepsGraph> m_dirty;
+
+	/**
+	 * Accessor to the texture view that creates it on demand, e.g., for a
+	 * debug view that is not displayed at every frame.
+	 */
+	using LazyTextureView = statdeps::Lazy<TextureViewResource, DepsGraph, &Application::m_textureView>;
+	template <typename DepsNode, typename Executor>
+	void parallelEnsureExists(Executor&& executor) { statdeps::parallelEnsureExists(*this, DepsNode{}, DepsGraph{}, executor); }
 };
 
 void Application::onInit() {
 	std::cout << "* Init" << std::endl;
-	// Initialize the texture view, and recursively all its dependencies before it.
-	ensureExists<TextureViewResource>();
+	// Initialize the bind group, and recursively all its dependencies before it.
+	// Independent resources are created concurrently by the thread pool.
+	statdeps::ThreadPool pool;
+	parallelEnsureExists<BindGroupResource>(pool);
 
 	std::cout << "* Init again" << std::endl;
 	// Running a second time should not change anything
-	ensureExists<TextureViewResource>();
+	ensureExists<BindGroupResource>();
 }
 
 void Application::onGui() {
@@ -158,40 +237,74 @@ void Application::onGui() {
 		rebuild<PathResource>();
 	}
 
+	// Simulate a reload of the same file, e.g., when hot-reloading
+	std::cout << "* Reload texture file, same content" << std::endl;
+	rebuild<PathResource>();
+
 	// Simulate a change of texture size
 	std::cout << "* Change texture path, different size" << std::endl;
 	m_path = "another/file.png";
 	rebuild<PathResource>();
-}
 
-// A simple type to string conversion, to demo dependency walking
-template <typename T>
-std::string type_name(T) { return "<unknown>"; }
-#define registerTypeName(T) template<> std::string type_name<T>(T) { return #T; }
-registerTypeName(Application::PathResource)
-registerTypeName(Application::DataResource)
-registerTypeName(Application::TextureResource)
-registerTypeName(Application::TextureViewResource)
-registerTypeName(Application::FakeResource)
+	// Simulate typing a new path, which changes it several times in a frame
+	std::cout << "* Change texture path several times in a frame" << std::endl;
+	for (const char* path : { "a", "an", "another/file.png" }) {
+		m_path = path;
+		m_dirty.invalidate(PathResource{});
+	}
+	m_dirty.flush(*this);
+
+	// Spread the rebuild over several frames, each given a time budget
+	std::cout << "* Change texture path, rebuild over several frames" << std::endl;
+	m_path = "some/file.jpg";
+	auto job = statdeps::beginRebuild(*this, PathResource{}, DepsGraph{});
+	while (!job.step(*this, std::chrono::milliseconds(2))) {
+		std::cout << "  (next frame, " << job.completedSteps() << "/" << job.StepCount << " steps done)" << std::endl;
+	}
+
+	// Only recreate what is used, here the texture view but not the bind group
+	std::cout << "* Change texture path, rebuild lazily" << std::endl;
+	m_path = "another/file.png";
+	statdeps::rebuildLazily(*this, PathResource{}, DepsGraph{});
+	auto& textureView = statdeps::get<LazyTextureView>(*this);
+	(void)textureView;
+}
 
 int main(int argc, char* argv[]) {
 	using AllDependees = decltype(statdeps::allDependees(Application::TextureResource{}, Application::DepsGraph{}));
 	std::cout << "All dependees of TextureResource:" << std::endl;
-	statdeps::forEach(AllDependees{}, [](auto&& arg) { std::cout << " - " << type_name(arg) << std::endl; });
+	statdeps::forEach(AllDependees{}, [](auto&& arg) { std::cout << " - " << statdeps::nodeName(arg) << std::endl; });
 	std::cout << std::endl;
 
 	using AllDependencies = decltype(statdeps::allDependencies(Application::TextureResource{}, Application::DepsGraph{}));
 	std::cout << "All dependencies of TextureResource:" << std::endl;
-	statdeps::forEach(AllDependencies{}, [](auto&& arg) { std::cout << " - " << type_name(arg) << std::endl; });
+	statdeps::forEach(AllDependencies{}, [](auto&& arg) { std::cout << " - " << statdeps::nodeName(arg) << std::endl; });
 	std::cout << std::endl;
 
 	using AllDependees2 = decltype(statdeps::allDependees(Application::PathResource{}, Application::DepsGraph{}));
 	std::cout << "All dependees of PathResource:" << std::endl;
-	statdeps::forEach(AllDependees2{}, [](auto&& arg) { std::cout << " - " << type_name(arg) << std::endl; });
+	statdeps::forEach(AllDependees2{}, [](auto&& arg) { std::cout << " - " << statdeps::nodeName(arg) << std::endl; });
 	std::cout << std::endl;
 
 	Application app;
 	app.onInit();
 	app.onGui();
+	std::cout << std::endl;
+
+	using Counters = statdeps::CountingInstrumentation;
+	std::cout << "Number of creations:" << std::endl;
+	std::cout << " - DataResource: " << Counters::counters<Application::DataResource>().creations << std::endl;
+	std::cout << " - TextureResource: " << Counters::counters<Application::TextureResource>().creations << std::endl;
+	std::cout << " - BindGroupResource: " << Counters::counters<Application::BindGroupResource>().creations << std::endl;
+	std::cout << std::endl;
+
+	// Export the graph annotated with the average creation time of each node,
+	// e.g., to render it with `dot -Tsvg`. The critical path is the chain that
+	// limits the startup time, however many threads create resources.
+	Application::DepsGraph graph;
+	auto costs = statdeps::measuredCosts(graph);
+	auto path = statdeps::criticalPath(graph, costs);
+	std::cout << "Critical path: " << path.cost << " ms out of " << path.totalCost << " ms" << std::endl;
+	statdeps::exportDot(std::cout, graph, costs);
 	return 0;
 }
@@ -9,6 +9,7 @@
 #include <vector>
 #include <utility>
 #include <iostream>
+#include <cstdint>
 
 namespace glm {
 struct uvec2 {
@@ -22,10 +23,13 @@ struct Texture {
 	glm::uvec2 size;
 };
 struct TextureView {};
+struct BindGroup {};
 } // namespace wgpu
 
 namespace ImGui {
+// Simulates the user typing a new path
 bool TextInput(const std::string& label, std::string* data) {
+	*data = "some/other-file.jpg";
 	return true;
 }
 } // namespace ImGui
@@ -34,7 +38,7 @@ std::pair<std::vector<uint8_t>, glm::uvec2> readImageFile(const std::string& pat
 	std::cout << "Read image file from '" << path << "'" << std::endl;
 	uint32_t width = path == "another/file.png" ? 200 : 100;
 	glm::uvec2 size = { width, width };
-	std::vector<uint8_t> data(size.x * size.y);
+	std::vector<uint8_t> data(size.x * size.y, static_cast<uint8_t>(path.size()));
 	return { data, size };
 }
 wgpu::Texture createTexture(const glm::uvec2& size) {
@@ -54,3 +58,10 @@ wgpu::TextureView createTextureView(wgpu::Texture texture) {
 void destroyTextureView(wgpu::TextureView textureView) {
 	std::cout << "Destroy texture view" << std::endl;
 }
+wgpu::BindGroup createBindGroup(wgpu::Texture texture, wgpu::TextureView textureView) {
+	std::cout << "Create bind group for texture with size (" << texture.size.x << ", " << texture.size.y << ")" << std::endl;
+	return {};
+}
+void destroyBindGroup(wgpu::BindGroup bindGroup) {
+	std::cout << "Destroy bind group" << std::endl;
+}
@@ -1,10 +1,18 @@
 #pragma once
 
 #include "depsgraph.hpp"
-
-#include <vector>
-#include <iostream>
-#include <functional>
+#include "graphtables.hpp"
+#include "boundnode.hpp"
+#include "oncestate.hpp"
+#include "instrumentation.hpp"
+#include "nodename.hpp"
+#include "trace.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
 
 namespace statdeps {
 
@@ -12,10 +20,13 @@ namespace statdeps {
 #pragma region [Declarations, list operations (public)]
 
 /**
- * Run a callback for each element of a list
+ * Run a callback for each element of a list, in order.
+ * NB: List operations are implemented with pack expansions rather than
+ *     recursion, so that their instantiation depth does not grow with the
+ *     length of the list.
  */
 template <typename... Items, typename Lambda>
-constexpr void forEach(List<Items...>, Lambda callback) noexcept;
+constexpr void forEach(List<Items...>, Lambda callback);
 
 /**
  * Basic operations on lists
@@ -32,6 +43,12 @@ constexpr auto concat(List<Items...>, List<OtherItems...>) noexcept;
 template <typename... Items>
 constexpr auto revert(List<Items...>) noexcept;
 
+/**
+ * Tell whether a list contains a given item
+ */
+template <typename... Items, typename Item>
+constexpr bool contains(List<Items...>, Item) noexcept;
+
 #pragma endregion
 
 ////////////////////////////////////////////////////
@@ -53,7 +70,8 @@ constexpr bool doesResourceExist(Context& ctx, Node, bool defaultValue);
 
 /**
  * Create the resource corresponding to a dependency node, if it does not
- * already exist, and update the ready state if appropriate.
+ * already exist, and update the ready state if appropriate. When the ready
+ * state is a OnceState, this is safe to call from several threads at once.
  */
 template <typename Context, typename Node>
 constexpr void createResource(Context& ctx, Node);
@@ -65,29 +83,80 @@ constexpr void createResource(Context& ctx, Node);
 template <typename Context, typename Node>
 constexpr void destroyResource(Context& ctx, Node);
 
+/**
+ * Update in place the resource corresponding to a dependency node, if it
+ * exists and the node has an update callback (see with_update). Returns
+ * whether it could be updated, otherwise it must be destroyed and created.
+ */
+template <typename Context, typename Node>
+constexpr bool updateResource(Context& ctx, Node);
+
+/**
+ * Raise the level of a resource built with_levels by one, if it exists and is
+ * not complete yet. Returns whether it is complete, which it is not if it
+ * does not exist.
+ */
+template <typename Context, typename Node>
+constexpr bool refineResource(Context& ctx, Node);
+
 #pragma endregion
 
 ////////////////////////////////////////////////////
 #pragma region [Declarations, depsgraph operations (public)]
 
 /**
- * Ensure that teh resource corresponding to the provided dependency node has
+ * Ensure that the resource corresponding to the provided dependency node has
  * been created, which recursively means to ensure that all of its dependencies
- * have also been created.
+ * have also been created. Each node of the dependency closure is checked at
+ * most once per call. It can be called concurrently from several threads if
+ * all nodes of the closure use with_once_state. Transient dependencies (see
+ * with_transient) are only created if a node that needs them is created.
+ *
+ * Exceptions thrown by callbacks are propagated to the caller, once the
+ * failed resource has been marked as absent, so that a later call retries.
+ */
+template <typename Context, typename Node, typename Graph>
+constexpr void ensureExists(Context& ctx, Node, Graph);
+
+/**
+ * Tell whether a node and all of its dependencies exist, except for transient
+ * ones (see with_transient). When they all keep their ready state in the
+ * same ReadyStore, this is a single mask test.
  */
 template <typename Context, typename Node, typename Graph>
-constexpr void ensureExists(typename Context& ctx, Node, Graph) noexcept;
+constexpr bool isClosureReady(Context& ctx, Node, Graph);
 
 /**
  * Destroy and recreate the resource corresponding to a node, and to the same
- * for all of its dependees.
+ * for all of its dependees. Nodes that have an update callback (see
+ * with_update) are updated in place instead whenever possible, in which case
+ * their own dependees are left untouched, and so are the dependees of nodes
+ * whose fingerprint did not change (see with_fingerprint).
+ */
+template <typename Context, typename Node, typename Graph>
+constexpr void rebuild(Context& ctx, Node, Graph);
+
+/**
+ * Rebuild several nodes at once, e.g. rebuild(ctx, List<A, B>{}, Graph{}).
+ * The union of their dependees is computed at compile time, so that the
+ * dependees they share are destroyed and recreated only once.
+ */
+template <typename Context, typename... Nodes, typename Graph>
+constexpr void rebuild(Context& ctx, List<Nodes...>, Graph);
+
+/**
+ * Refine a node built with_levels by one level (see refineResource), e.g.,
+ * once per frame to stream the rest of a texture of which dependees only
+ * required the first mips. Its dependees are left untouched. Returns whether
+ * it is complete.
  */
 template <typename Context, typename Node, typename Graph>
-constexpr void rebuild(typename Context& ctx, Node, Graph) noexcept;
+constexpr bool refine(Context& ctx, Node, Graph);
 
 /**
  * Get all nodes on which the given node depends, be it directly or indirectly.
- * Returned nodes are sorted by dependency order (the first one depends on nothing).
+ * Returned nodes are sorted by dependency order (the first one depends on nothing)
+ * and each node appears only once, even if it is reachable through several paths.
  */
 template <typename Node, typename Graph>
 constexpr auto allDependencies(Node, Graph) noexcept;
@@ -95,32 +164,23 @@ constexpr auto allDependencies(Node, Graph) noexcept;
 /**
  * Get all nodes that depend directly or indirectly on a given one.
  * Returned nodes are sorted by dependency order (the first one depends
- * directly on the given node).
+ * directly on the given node) and each node appears only once, even if it is
+ * reachable through several paths.
  */
 template <typename Node, typename Graph>
 constexpr auto allDependees(Node, Graph) noexcept;
 
-/**
- * Mostly for debug: list in the stdout the dependencies of a node.
- */
-template <typename Node, typename Graph>
-constexpr void printDependencies(Node, Graph) noexcept;
-
 #pragma endregion
 
 ////////////////////////////////////////////////////
 #pragma region [Definitions, list operations (private)]
 
-// forEachInList()
+// forEach()
 
-template <typename FirstItem, typename... OtherItems, typename Lambda>
-constexpr void forEach(List<FirstItem, OtherItems...>, Lambda lambda) noexcept {
-	lambda(FirstItem{});
-	forEach(List<OtherItems...>{}, lambda);
-}
-
-template <typename Lambda>
-constexpr void forEach(List<>, Lambda) noexcept {
+template <typename... Items, typename Lambda>
+constexpr void forEach(List<Items...>, Lambda callback) {
+	// The comma fold guarantees left-to-right evaluation
+	(callback(Items{}), ...);
 }
 
 // prepend()
@@ -146,14 +206,21 @@ constexpr auto concat(List<Items...>, List<OtherItems...>) noexcept {
 
 // revert()
 
-template <typename FirstItem, typename... Items>
-constexpr auto revert(List<FirstItem, Items...>) noexcept {
-	return append(revert(List<Items...>{}), FirstItem{});
+template <typename... Items, std::size_t... Is>
+constexpr auto revert(List<Items...>, std::index_sequence<Is...>) noexcept {
+	return List<detail::TypeAt<sizeof...(Items) - 1 - Is, Items...>...>{};
 }
 
-template <>
-constexpr auto revert(List<>) noexcept {
-	return List<>{};
+template <typename... Items>
+constexpr auto revert(List<Items...>) noexcept {
+	return revert(List<Items...>{}, std::index_sequence_for<Items...>{});
+}
+
+// contains()
+
+template <typename... Items, typename Item>
+constexpr bool contains(List<Items...>, Item) noexcept {
+	return (std::is_same_v<Items, Item> || ...);
 }
 
 #pragma endregion
@@ -163,11 +230,12 @@ constexpr auto revert(List<>) noexcept {
 
 template <typename Context, typename Node>
 constexpr bool doesResourceExist(Context& ctx, Node, bool defaultValue) {
+	static_assert(!detail::needsGraph<Node>(), "Nodes with_ready_store, with_output or with_cache can only be used within a graph");
 	if constexpr (Node::UseReadyState()) {
 		return Node::ReadyState(ctx);
 	}
 	else if constexpr (Node::UseExists()) {
-		return Node::Exists(ctx);
+		return detail::instrumentedExists<Node>(ctx);
 	}
 	else {
 		return defaultValue;
@@ -176,41 +244,229 @@ constexpr bool doesResourceExist(Context& ctx, Node, bool defaultValue) {
 
 template <typename Context, typename Node>
 constexpr void createResource(Context& ctx, Node) {
+	static_assert(Node::UseCreate() || !Node::template HasOption<AsyncCreateOption>(), "This node can only be created by asyncEnsureExists()");
+	static_assert(!detail::needsGraph<Node>(), "Nodes with_ready_store, with_output or with_cache can only be used within a graph");
 	if constexpr (Node::UseReadyState()) {
-		bool& ready = Node::ReadyState(ctx);
-		if (!ready) {
-			Node::Create(ctx);
+		auto&& ready = Node::ReadyState(ctx);
+		if constexpr (std::is_same_v<std::decay_t<decltype(ready)>, OnceState>) {
+			// Other threads may be creating the same resource
+			ready.callOnce([&ctx]() { detail::instrumentedCreate<Node>(ctx); });
+		}
+		else if (!ready) {
+			detail::instrumentedCreate<Node>(ctx);
 			ready = true;
 		}
 	}
 	else if constexpr (Node::UseExists()) {
-		if (!Node::Exists(ctx)) {
-			Node::Create(ctx);
+		if (!detail::instrumentedExists<Node>(ctx)) {
+			detail::instrumentedCreate<Node>(ctx);
 		}
 	}
 	else {
-		Node::Create(ctx);
+		detail::instrumentedCreate<Node>(ctx);
 	}
 }
 
 template <typename Context, typename Node>
 constexpr void destroyResource(Context& ctx, Node) {
+	static_assert(!detail::needsGraph<Node>(), "Nodes with_ready_store, with_output or with_cache can only be used within a graph");
 	if constexpr (Node::UseReadyState()) {
-		bool& ready = Node::ReadyState(ctx);
+		auto&& ready = Node::ReadyState(ctx);
 		if (ready) {
-			Node::Destroy(ctx);
+			detail::instrumentedDestroy<Node>(ctx);
 			ready = false;
 		}
 	}
 	else if constexpr (Node::UseExists()) {
-		if (Node::Exists(ctx)) {
-			Node::Destroy(ctx);
+		if (detail::instrumentedExists<Node>(ctx)) {
+			detail::instrumentedDestroy<Node>(ctx);
+		}
+	}
+	else {
+		detail::instrumentedDestroy<Node>(ctx);
+	}
+}
+
+// Variants of destroyResource(), createResource() and updateResource() used
+// when the existence of the resource has already been checked, to avoid
+// checking it again.
+
+template <typename Context, typename Node>
+constexpr void destroyExistingResource(Context& ctx, Node, bool exists) {
+	static_assert(!detail::needsGraph<Node>(), "Nodes with_ready_store, with_output or with_cache can only be used within a graph");
+	if (exists) {
+		detail::instrumentedDestroy<Node>(ctx);
+		if constexpr (Node::UseReadyState()) {
+			Node::ReadyState(ctx) = false;
+		}
+	}
+}
+
+template <typename Context, typename Node>
+constexpr void createMissingResource(Context& ctx, Node, bool shouldCreate) {
+	static_assert(Node::UseCreate() || !Node::template HasOption<AsyncCreateOption>(), "This node can only be created by asyncEnsureExists()");
+	static_assert(!detail::needsGraph<Node>(), "Nodes with_ready_store, with_output or with_cache can only be used within a graph");
+	if (shouldCreate) {
+		detail::instrumentedCreate<Node>(ctx);
+		if constexpr (Node::UseReadyState()) {
+			Node::ReadyState(ctx) = true;
+		}
+	}
+}
+
+template <typename Context, typename Node>
+constexpr bool updateExistingResource(Context& ctx, Node) {
+	constexpr auto fn = Node::template Option<UpdateOption>::function;
+	if constexpr (std::is_base_of_v<detail::GraphBoundTag, Node>) {
+		return Node::Update(ctx);
+	}
+	else if constexpr (Node::HasNoContext::value) {
+		return detail::instrument<Node>(NodeEvent::Update, [&]() { return fn(); });
+	}
+	else {
+		return detail::instrument<Node>(NodeEvent::Update, [&]() { return (ctx.*fn)(); });
+	}
+}
+
+template <typename Context, typename Node>
+constexpr bool updateResource(Context& ctx, Node) {
+	if constexpr (Node::template HasOption<UpdateOption>()) {
+		return doesResourceExist(ctx, Node{}, true) && updateExistingResource(ctx, Node{});
+	}
+	else {
+		return false;
+	}
+}
+
+template <typename Context, typename Node>
+constexpr bool refineResource(Context& ctx, Node) {
+	static_assert(Node::template HasOption<LevelsOption>(), "Only nodes with_levels can be refined");
+	static_assert(!Node::template HasOption<OnceStateOption>(), "Nodes cannot have both with_once_state and with_levels");
+	static_assert(!detail::needsGraph<Node>(), "Nodes with_ready_store, with_output or with_cache can only be used within a graph");
+	using Levels = typename Node::template Option<LevelsOption>;
+	auto& level = Node::ReadyState(ctx);
+	if (level == 0) return false;
+	if (level < Levels::Count) {
+		const std::size_t next = static_cast<std::size_t>(level) + 1;
+		detail::instrument<Node>(NodeEvent::Refine, [&]() {
+			if constexpr (Node::HasNoContext::value) {
+				Levels::function(next);
+			}
+			else {
+				(ctx.*Levels::function)(next);
+			}
+		});
+		level = static_cast<std::remove_reference_t<decltype(level)>>(next);
+	}
+	return level >= Levels::Count;
+}
+
+namespace detail {
+
+// Record a decision about a node into its trace buffer, if any (see with_trace)
+template <typename Tables, typename Node, typename Context>
+constexpr void traceDecision(Context& ctx, TraceAction action, TraceReason reason) noexcept {
+	using Target = typename Unbound<Node>::Type;
+	if constexpr (Target::template HasOption<TraceOption>()) {
+		constexpr auto buffer = Target::template Option<TraceOption>::member;
+		const TraceEntry entry{ static_cast<std::uint32_t>(Tables::template IndexOf<Target>), nodeName(Target{}), action, reason };
+		if constexpr (Target::HasNoContext::value) {
+			buffer->record(entry);
+		}
+		else {
+			(ctx.*buffer).record(entry);
 		}
 	}
 	else {
-		Node::Destroy(ctx);
+		(void)ctx;
+		(void)action;
+		(void)reason;
 	}
 }
+
+// The node operations above as function pointers of a same signature, taking
+// the context and a flag saying whether the resource existed, for algorithms
+// that schedule nodes at runtime.
+
+template <typename Context, typename Node>
+struct CreateTask {
+	static void run(Context& ctx, bool) { createResource(ctx, Node{}); }
+};
+
+template <typename Context, typename Node>
+struct DestroyTask {
+	static void run(Context& ctx, bool) { destroyResource(ctx, Node{}); }
+};
+
+template <typename Context, typename Node>
+struct ExistenceQuery {
+	static bool run(Context& ctx) { return doesResourceExist(ctx, Node{}, true); }
+};
+
+template <typename Context, typename Node>
+struct DestroyExistingTask {
+	static void run(Context& ctx, bool exists) { destroyExistingResource(ctx, Node{}, exists); }
+};
+
+template <typename Context, typename Node>
+struct CreateMissingTask {
+	static void run(Context& ctx, bool shouldCreate) { createMissingResource(ctx, Node{}, shouldCreate); }
+};
+
+template <typename Context, typename Node>
+struct FingerprintQuery {
+	static std::uint64_t run(Context& ctx) { return fingerprintOf<Node>(ctx); }
+};
+
+template <typename Context, typename Node>
+struct UpdateExistingQuery {
+	static bool run(Context& ctx) {
+		if constexpr (Node::template HasOption<UpdateOption>()) {
+			return updateExistingResource(ctx, Node{});
+		}
+		else {
+			return false;
+		}
+	}
+};
+
+template <typename Context, typename Tables, typename Node>
+struct TraceTask {
+	static void run(Context& ctx, TraceAction action, TraceReason reason) { traceDecision<Tables, Node>(ctx, action, reason); }
+};
+
+// Whether rebuilding a node affects its dependees is only known at runtime
+template <typename Node>
+constexpr bool needsCutoff() {
+	return Node::template HasOption<UpdateOption>() || Node::template HasOption<FingerprintOption>();
+}
+
+// Operations on each node of a graph, indexed by node index
+template <typename Context, typename Tables, typename Indices = std::make_index_sequence<Tables::NodeCount>>
+struct NodeOperations;
+
+template <typename Context, typename Tables, std::size_t... Is>
+struct NodeOperations<Context, Tables, std::index_sequence<Is...>> {
+	using Exists = bool (*)(Context&);
+	using Task = void (*)(Context&, bool);
+	using Hash = std::uint64_t (*)(Context&);
+	using Trace = void (*)(Context&, TraceAction, TraceReason);
+
+	static constexpr std::array<Exists, sizeof...(Is)> exists = { &ExistenceQuery<Context, BindNode<typename Tables::template NodeAt<Is>, Tables>>::run... };
+	static constexpr std::array<Task, sizeof...(Is)> destroy = { &DestroyTask<Context, BindNode<typename Tables::template NodeAt<Is>, Tables>>::run... };
+	static constexpr std::array<Task, sizeof...(Is)> destroyExisting = { &DestroyExistingTask<Context, BindNode<typename Tables::template NodeAt<Is>, Tables>>::run... };
+	static constexpr std::array<Task, sizeof...(Is)> createMissing = { &CreateMissingTask<Context, BindNode<typename Tables::template NodeAt<Is>, Tables>>::run... };
+	static constexpr std::array<Exists, sizeof...(Is)> updateExisting = { &UpdateExistingQuery<Context, BindNode<typename Tables::template NodeAt<Is>, Tables>>::run... };
+	static constexpr std::array<bool, sizeof...(Is)> updatable = { Tables::template NodeAt<Is>::template HasOption<UpdateOption>()... };
+	static constexpr std::array<Hash, sizeof...(Is)> fingerprint = { &FingerprintQuery<Context, BindNode<typename Tables::template NodeAt<Is>, Tables>>::run... };
+	static constexpr std::array<bool, sizeof...(Is)> fingerprinted = { Tables::template NodeAt<Is>::template HasOption<FingerprintOption>()... };
+	static constexpr bool anyCutoff = (false || ... || needsCutoff<typename Tables::template NodeAt<Is>>());
+	static constexpr std::array<Trace, sizeof...(Is)> trace = { &TraceTask<Context, Tables, typename Tables::template NodeAt<Is>>::run... };
+	static constexpr bool anyTraced = (false || ... || Tables::template NodeAt<Is>::template HasOption<TraceOption>());
+};
+
+} // namespace detail
+
 #pragma endregion
 
 ////////////////////////////////////////////////////
@@ -218,136 +474,343 @@ constexpr void destroyResource(Context& ctx, Node) {
 
 // ensureExists()
 
-template <typename Context, typename Node, typename Graph>
-constexpr void ensureExists(typename Context& ctx, Node, Graph) noexcept {
-	ensureDependenciesExist(ctx, Node{}, Graph{}, Graph::EdgeList{});
+namespace detail {
 
-	if constexpr (Node::UseReadyState()) {
-		bool& ready = Node::ReadyState(ctx);
-		if (!ready) {
-			Node::Create(ctx);
-			ready = true;
-		}
+template <typename Tables, typename Node, typename... Dependencies>
+constexpr bool closureSharesReadyStore(List<Dependencies...>) {
+	if constexpr (Tables::template IndexOf<Node> == Tables::NodeCount) {
+		return false;
 	}
-	else if constexpr (Node::UseExists()) {
-		if (!Node::Exists(ctx)) {
-			Node::Create(ctx);
+	else {
+		return shareReadyStore<Node, Dependencies...>();
+	}
+}
+
+template <typename Tables, typename Node>
+constexpr bool closureSharesReadyStore() {
+	return closureSharesReadyStore<Tables, Node>(typename Tables::template DependenciesOf<Node>{});
+}
+
+// Transient dependencies (see with_transient) are only created when needed
+// by one of their dependees, so they are not required to exist.
+template <typename Target, typename Node>
+constexpr bool isRequired() {
+	return std::is_same_v<Node, Target> || !Node::template HasOption<TransientOption>();
+}
+
+// Create a node of the closure of Target unless it exists or is a transient
+// dependency, once its dependencies have been created
+template <typename Tables, typename Target, typename Context, typename Node>
+constexpr void ensureNodeExists(Context& ctx, Node) {
+	using Bound = BindNode<Node, Tables>;
+	if constexpr (!isRequired<Target, Node>()) {
+		traceDecision<Tables, Bound>(ctx, TraceAction::Skipped, TraceReason::Transient);
+	}
+	else if constexpr (Bound::template HasOption<TraceOption>()) {
+		const bool existed = doesResourceExist(ctx, Bound{}, false);
+		if constexpr (Bound::template HasOption<OnceStateOption>()) {
+			// Other threads may be creating the same resource
+			createResource(ctx, Bound{});
+		}
+		else {
+			createMissingResource(ctx, Bound{}, !existed);
 		}
+		traceDecision<Tables, Bound>(ctx, existed ? TraceAction::Skipped : TraceAction::Created, existed ? TraceReason::AlreadyExists : TraceReason::Missing);
 	}
 	else {
-		Node::Create(ctx);
+		createResource(ctx, Bound{});
 	}
 }
 
-template <typename Context, typename Node, typename Graph, typename Dependency, typename... OtherEdges>
-constexpr void ensureDependenciesExist(typename Context& ctx, Node, Graph, List<DepsEdge<Node, Dependency>, OtherEdges...>) noexcept {
-	ensureExists(ctx, Dependency{}, Graph{});
-	ensureDependenciesExist(ctx, Node{}, Graph{}, List<OtherEdges...>{});
+// Trace a node of the closure of Target when the whole closure exists
+template <typename Tables, typename Target, typename Context, typename Node>
+constexpr void traceExisting(Context& ctx, Node) noexcept {
+	if constexpr (isRequired<Target, Node>()) {
+		traceDecision<Tables, Node>(ctx, TraceAction::Skipped, TraceReason::AlreadyExists);
+	}
+	else {
+		traceDecision<Tables, Node>(ctx, TraceAction::Skipped, TraceReason::Transient);
+	}
 }
 
-template <typename Context, typename Node, typename Graph, typename FirstEdge, typename... OtherEdges>
-constexpr void ensureDependenciesExist(typename Context& ctx, Node, Graph, List<FirstEdge, OtherEdges...>) noexcept {
-	ensureDependenciesExist(ctx, Node{}, Graph{}, List<OtherEdges...>{});
+template <typename Context, typename Tables, typename Target, typename... Nodes>
+constexpr bool isEachReady(Context& ctx, List<Nodes...>) {
+	return ((!isRequired<Target, Nodes>() || doesResourceExist(ctx, BindNode<Nodes, Tables>{}, false)) && ...);
 }
 
-template <typename Context, typename Node, typename Graph>
-constexpr void ensureDependenciesExist(typename Context& ctx, Node, Graph, List<>) noexcept {
+template <typename Tables, std::size_t I>
+constexpr std::size_t requiredDependencyCount() {
+	std::size_t count = 0;
+	for (std::size_t i : Tables::template dependencyClosure<I>) {
+		if (!optionFlagsOf<Tables, TransientOption>[i]) ++count;
+	}
+	return count;
 }
 
-// rebuild()
+template <typename Tables, std::size_t I>
+inline constexpr auto requiredDependencies = [] {
+	std::array<std::size_t, requiredDependencyCount<Tables, I>()> indices{};
+	std::size_t k = 0;
+	for (std::size_t i : Tables::template dependencyClosure<I>) {
+		if (!optionFlagsOf<Tables, TransientOption>[i]) indices[k++] = i;
+	}
+	return indices;
+}();
 
-template <typename Context, typename Node, typename Graph>
-constexpr void rebuild(typename Context& ctx, Node, Graph) noexcept {
-	rebuild(ctx, Node{}, Graph{}, revert(allDependees(Node{}, Graph{})));
-}
+template <typename Tables, std::size_t I, std::size_t WordCount>
+inline constexpr auto closureMask = storeMask<WordCount>(requiredDependencies<Tables, I>, I);
 
-template <typename Context, typename Node, typename Graph, typename FirstDependee, typename... OtherDependees>
-constexpr void rebuild(typename Context& ctx, Node, Graph, List<FirstDependee, OtherDependees...>) noexcept {
-	bool shouldRecreate = doesResourceExist(ctx, FirstDependee{}, true);
-	destroyResource(ctx, FirstDependee{});
-	
-	rebuild(ctx, Node{}, Graph{}, List<OtherDependees...>{});
+} // namespace detail
 
-	if (shouldRecreate) {
-		createResource(ctx, FirstDependee{});
+template <typename Context, typename Node, typename Graph>
+constexpr void ensureExists(Context& ctx, Node, Graph) {
+	// The closure is deduplicated at compile time, so that a node shared by
+	// many dependees is only checked once, then created in dependency order.
+	using Tables = typename Graph::Tables;
+	auto closure = append(allDependencies(Node{}, Graph{}), Node{});
+	if constexpr (detail::closureSharesReadyStore<Tables, Node>()) {
+		if (isClosureReady(ctx, Node{}, Graph{})) {
+			forEach(closure, [&ctx](auto node) { detail::traceExisting<Tables, Node>(ctx, node); });
+			return;
+		}
 	}
+	forEach(closure, [&ctx](auto node) { detail::ensureNodeExists<Tables, Node>(ctx, node); });
 }
 
+// isClosureReady()
+
 template <typename Context, typename Node, typename Graph>
-constexpr void rebuild(typename Context& ctx, Node, Graph, List<>) noexcept {
-	destroyResource(ctx, Node{});
-	createResource(ctx, Node{});
+constexpr bool isClosureReady(Context& ctx, Node, Graph) {
+	using Tables = typename Graph::Tables;
+	if constexpr (detail::closureSharesReadyStore<Tables, Node>()) {
+		using Bound = detail::GraphBoundNode<Node, Tables>;
+		using Store = std::remove_reference_t<decltype(Bound::Store(ctx))>;
+		constexpr auto& mask = detail::closureMask<Tables, Tables::template IndexOf<Node>, Store::WordCount>;
+		return Bound::Store(ctx).contains(mask);
+	}
+	else {
+		return detail::isEachReady<Context, Tables, Node>(ctx, append(allDependencies(Node{}, Graph{}), Node{}));
+	}
 }
 
-// allDependencies()
+// rebuild()
 
-template <typename Node, typename Graph>
-constexpr auto allDependencies(Node, Graph) noexcept {
-	return allDependencies(Node{}, Graph{}, Graph::EdgeList{});
+namespace detail {
+
+// Rebuilt nodes are destroyed only if they exist at the time of destroying
+// them, like destroyResource() does.
+template <bool IsRoot, typename Context, typename Node>
+constexpr void destroyAffected(Context& ctx, Node, bool existed) {
+	if constexpr (IsRoot) {
+		destroyResource(ctx, Node{});
+	}
+	else {
+		destroyExistingResource(ctx, Node{}, existed);
+	}
 }
 
-template <typename Node, typename Graph, typename Dependency, typename... OtherEdges>
-constexpr auto allDependencies(Node, Graph, List<DepsEdge<Node, Dependency>, OtherEdges...>) noexcept {
-	auto otherDependencies = allDependencies(Node{}, Graph{}, List<OtherEdges...>{});
-	auto dependenciesOfDependencies = allDependencies(Dependency{}, Graph{});
-	return concat(dependenciesOfDependencies, prepend(Dependency{}, otherDependencies)); // TODO
+template <typename Tables, bool IsRoot, typename Context, typename Node>
+constexpr void traceRebuilt(Context& ctx, Node, bool existed) noexcept {
+	if constexpr (IsRoot) {
+		traceDecision<Tables, Node>(ctx, TraceAction::Rebuilt, TraceReason::Requested);
+	}
+	else if (existed) {
+		traceDecision<Tables, Node>(ctx, TraceAction::Rebuilt, TraceReason::DependencyChanged);
+	}
+	else {
+		traceDecision<Tables, Node>(ctx, TraceAction::Skipped, TraceReason::Missing);
+	}
 }
 
-template <typename Node, typename Graph, typename FirstEdge, typename... OtherEdges>
-constexpr auto allDependencies(Node, Graph, List<FirstEdge, OtherEdges...>) noexcept {
-	return allDependencies(Node{}, Graph{}, List<OtherEdges...>{});
+template <typename Context, typename Tables, typename Roots, typename... Affected, std::size_t... Is>
+constexpr void rebuildUnion(Context& ctx, Roots, List<Affected...>, std::index_sequence<Is...>) {
+	constexpr std::size_t Count = sizeof...(Affected);
+
+	// Only recreate dependees that existed before the rebuild, while the
+	// rebuilt nodes themselves are always recreated. Existence is checked
+	// only once per dependee, since destroying a resource does not change
+	// whether the others exist.
+	std::array<bool, Count> existed = { (contains(Roots{}, Affected{}) || doesResourceExist(ctx, BindNode<Affected, Tables>{}, true))... };
+
+	// Destroy in reverse topological order, then create them back in
+	// topological order. Comma folds are evaluated left to right.
+	(destroyAffected<contains(Roots{}, TypeAt<Count - 1 - Is, Affected...>{})>(ctx, BindNode<TypeAt<Count - 1 - Is, Affected...>, Tables>{}, existed[Count - 1 - Is]), ...);
+	(createMissingResource(ctx, BindNode<Affected, Tables>{}, existed[Is]), ...);
+	(traceRebuilt<Tables, contains(Roots{}, Affected{})>(ctx, Affected{}, existed[Is]), ...);
+	(void)existed;
 }
 
-template <typename Node, typename Graph>
-constexpr auto allDependencies(Node, Graph, List<>) noexcept {
-	return List<>{};
+/**
+ * Same as rebuildUnion(), when some nodes can be updated in place (see
+ * with_update) or have a fingerprint (see with_fingerprint), so that whether
+ * their dependees are affected is only known at runtime. Candidate nodes are
+ * given by graph index in topological order: a node is affected if it is a
+ * root or if one of its dependencies changed, in which case it is either
+ * updated in place or rebuilt, and it changed unless its update succeeded or
+ * its fingerprint is the same once created again. Since this is only known
+ * in the creation pass, the dependees of such nodes are destroyed then.
+ */
+template <typename Context, typename Tables>
+void rebuildWithCutoff(Context& ctx, const std::size_t* order, std::size_t count, const std::array<bool, Tables::NodeCount>& roots) {
+	using Operations = NodeOperations<Context, Tables>;
+	constexpr std::size_t NodeCount = Tables::NodeCount;
+	std::array<bool, NodeCount> existed{};
+	std::array<bool, NodeCount> toUpdate{};
+	std::array<bool, NodeCount> rebuilt{};
+	std::array<bool, NodeCount> destroyed{};
+	std::array<bool, NodeCount> changed{};
+	std::array<std::uint64_t, NodeCount> fingerprints{};
+
+	// Whether a rebuilt node has changed is known right away, unless it has a
+	// fingerprint to compare once created again.
+	auto markRebuilt = [&](std::size_t i) {
+		rebuilt[i] = true;
+		changed[i] = !(Operations::fingerprinted[i] && existed[i]);
+		if (!changed[i]) fingerprints[i] = Operations::fingerprint[i](ctx);
+	};
+
+	// Mark the nodes affected by the ones changed so far, from the k-th one.
+	// Existence is checked only once per node, when it gets affected.
+	auto propagate = [&](std::size_t first) {
+		for (std::size_t k = first; k < count; ++k) {
+			std::size_t i = order[k];
+			if (rebuilt[i] || toUpdate[i]) continue;
+			bool affected = roots[i];
+			for (std::size_t e = Tables::dependencyOffsets[i]; e < Tables::dependencyOffsets[i + 1] && !affected; ++e) {
+				affected = changed[Tables::dependencies[e]];
+			}
+			if (!affected) continue;
+			existed[i] = Operations::exists[i](ctx);
+			if (Operations::updatable[i] && existed[i]) toUpdate[i] = true;
+			else markRebuilt(i);
+		}
+	};
+
+	// Destroy rebuilt nodes that are not destroyed yet, from the last one
+	auto destroyFrom = [&](std::size_t first) {
+		for (std::size_t k = count; k-- > first;) {
+			std::size_t i = order[k];
+			if (rebuilt[i] && !destroyed[i]) {
+				Operations::destroyExisting[i](ctx, existed[i]);
+				destroyed[i] = true;
+			}
+		}
+	};
+
+	propagate(0);
+	destroyFrom(0);
+	for (std::size_t k = 0; k < count; ++k) {
+		std::size_t i = order[k];
+		if (toUpdate[i]) {
+			if (Operations::updateExisting[i](ctx)) continue;
+			toUpdate[i] = false;
+			markRebuilt(i);
+			propagate(k + 1);
+			destroyFrom(k);
+		}
+		if (!rebuilt[i]) continue;
+
+		// The rebuilt nodes themselves are always recreated
+		Operations::createMissing[i](ctx, existed[i] || roots[i]);
+		if (!changed[i] && Operations::fingerprint[i](ctx) != fingerprints[i]) {
+			changed[i] = true;
+			propagate(k + 1);
+			destroyFrom(k + 1);
+		}
+	}
+
+	if constexpr (Operations::anyTraced) {
+		for (std::size_t k = 0; k < count; ++k) {
+			std::size_t i = order[k];
+			if (toUpdate[i]) {
+				Operations::trace[i](ctx, TraceAction::Updated, roots[i] ? TraceReason::Requested : TraceReason::DependencyChanged);
+			}
+			else if (!rebuilt[i]) {
+				Operations::trace[i](ctx, TraceAction::Skipped, TraceReason::DependenciesUnchanged);
+			}
+			else if (!existed[i] && !roots[i]) {
+				Operations::trace[i](ctx, TraceAction::Skipped, TraceReason::Missing);
+			}
+			else if (Operations::updatable[i] && existed[i]) {
+				Operations::trace[i](ctx, TraceAction::Rebuilt, TraceReason::UpdateFailed);
+			}
+			else {
+				Operations::trace[i](ctx, TraceAction::Rebuilt, roots[i] ? TraceReason::Requested : TraceReason::DependencyChanged);
+			}
+		}
+	}
 }
 
-// allDependees()
+template <typename Tables, typename... Nodes>
+inline constexpr std::array<std::size_t, sizeof...(Nodes)> indicesOf = { Tables::template IndexOf<Nodes>... };
 
-template <typename Node, typename Graph>
-constexpr auto allDependees(Node, Graph) noexcept {
-	return allDependees(Node{}, Graph{}, Graph::EdgeList{});
+template <typename Tables, typename... Roots>
+constexpr std::array<bool, Tables::NodeCount> rootFlags(List<Roots...>) {
+	std::array<bool, Tables::NodeCount> flags{};
+	for (std::size_t i : indicesOf<Tables, Roots...>) {
+		if (i < Tables::NodeCount) flags[i] = true;
+	}
+	return flags;
 }
 
-template <typename Node, typename Graph, typename Dependee, typename... OtherEdges>
-constexpr auto allDependees(Node, Graph, List<DepsEdge<Dependee, Node>, OtherEdges...>) noexcept {
-	auto otherDependees = allDependees(Node{}, Graph{}, List<OtherEdges...>{});
-	auto dependeesOfDependees = allDependees(Dependee{}, Graph{});
-	return prepend(Dependee{}, concat(dependeesOfDependees, otherDependees)); // TODO
+template <typename Tables, typename Roots>
+inline constexpr std::array<bool, Tables::NodeCount> rootFlagsOf = rootFlags<Tables>(Roots{});
+
+template <typename Context, typename Tables, typename Roots, typename... Affected>
+constexpr void rebuildUnion(Context& ctx, Roots, List<Affected...>) {
+	if constexpr ((needsCutoff<Affected>() || ...)) {
+		constexpr auto& order = indicesOf<Tables, Affected...>;
+		rebuildWithCutoff<Context, Tables>(ctx, order.data(), order.size(), rootFlagsOf<Tables, Roots>);
+	}
+	else {
+		rebuildUnion<Context, Tables>(ctx, Roots{}, List<Affected...>{}, std::index_sequence_for<Affected...>{});
+	}
 }
 
-template <typename Node, typename Graph, typename FirstEdge, typename... OtherEdges>
-constexpr auto allDependees(Node, Graph, List<FirstEdge, OtherEdges...>) noexcept {
-	return allDependees(Node{}, Graph{}, List<OtherEdges...>{});
+} // namespace detail
+
+template <typename Context, typename Node, typename Graph>
+constexpr void rebuild(Context& ctx, Node, Graph) {
+	rebuild(ctx, List<Node>{}, Graph{});
 }
 
-template <typename Node, typename Graph>
-constexpr auto allDependees(Node, Graph, List<>) noexcept {
-	return List<>{};
+template <typename Context, typename... Nodes, typename Graph>
+constexpr void rebuild(Context& ctx, List<Nodes...>, Graph) {
+	using Tables = typename Graph::Tables;
+	detail::rebuildUnion<Context, Tables>(ctx, List<Nodes...>{}, typename Tables::template DependeeUnionOf<Nodes...>{});
+
+	// Nodes that are not part of the graph have no dependee
+	auto rebuildAlone = [&ctx](auto node) {
+		if constexpr (Tables::template IndexOf<decltype(node)> == Tables::NodeCount) {
+			if (!updateResource(ctx, node)) {
+				destroyResource(ctx, node);
+				createResource(ctx, node);
+			}
+		}
+	};
+	(rebuildAlone(Nodes{}), ...);
+	(void)rebuildAlone;
 }
 
-// printDependencies()
+// refine()
 
-template <typename Node, typename Graph>
-constexpr void printDependencies(Node, Graph) noexcept {
-	printDependencies(Node{}, Graph{}, Graph::EdgeList{});
+template <typename Context, typename Node, typename Graph>
+constexpr bool refine(Context& ctx, Node, Graph) {
+	return refineResource(ctx, detail::BindNode<Node, typename Graph::Tables>{});
 }
 
-template <typename Node, typename Graph, typename Dependency, typename... OtherEdges>
-constexpr void printDependencies(Node, Graph, List<DepsEdge<Node, Dependency>, OtherEdges...>) noexcept {
-	printDependencies(Dependency{}, Graph{});
-	Dependency::PrettyPrint();
-	printDependencies(Node{}, Graph{}, List<OtherEdges...>{});
-}
+// allDependencies()
 
-template <typename Node, typename Graph, typename FirstEdge, typename... OtherEdges>
-constexpr void printDependencies(Node, Graph, List<FirstEdge, OtherEdges...>) noexcept {
-	printDependencies(Node{}, Graph{}, List<OtherEdges...>{});
+template <typename Node, typename Graph>
+constexpr auto allDependencies(Node, Graph) noexcept {
+	return typename Graph::Tables::template DependenciesOf<Node>{};
 }
 
+// allDependees()
+
 template <typename Node, typename Graph>
-constexpr void printDependencies(Node, Graph, List<>) noexcept {
+constexpr auto allDependees(Node, Graph) noexcept {
+	return typename Graph::Tables::template DependeesOf<Node>{};
 }
 
 #pragma endregion
@@ -0,0 +1,534 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "algorithms.hpp"
+
+#if !defined(__cpp_impl_coroutine)
+#error "statdeps/async.hpp requires C++20 coroutines"
+#endif
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <condition_variable>
+
+namespace statdeps {
+
+namespace detail {
+struct SyncWaitState;
+} // namespace detail
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A lazily started coroutine, which runs when awaited and resumes its
+ * awaiter once done, rethrowing its exception if any. It can be returned by
+ * the callbacks given to with_async_create, although any awaitable works.
+ */
+class Task {
+public:
+	struct promise_type;
+
+	// An empty task, which completes immediately
+	Task() noexcept = default;
+	Task(Task&& other) noexcept;
+	Task& operator=(Task&& other) noexcept;
+	~Task();
+
+	struct Awaiter;
+	Awaiter operator co_await() const noexcept;
+
+private:
+	explicit Task(std::coroutine_handle<promise_type> handle) noexcept;
+
+	friend void syncWait(Task task);
+
+private:
+	std::coroutine_handle<promise_type> m_handle = nullptr;
+};
+
+/**
+ * Run a task to completion, blocking the calling thread until it is done.
+ * Meanwhile, the calling thread creates the nodes built with_main_thread of
+ * the graphs that the task goes through.
+ */
+void syncWait(Task task);
+
+/**
+ * Same as ensureExists(), but for graphs where some nodes are created
+ * asynchronously (see with_async_create). The returned task completes once
+ * the node and all of its dependencies are ready.
+ *
+ * Each node is started as soon as its dependencies are ready, so the
+ * creation of independent resources overlaps rather than adding up. Nodes
+ * with a regular create callback are created by whichever thread resumes
+ * them, namely the one that completed their last dependency, except for
+ * nodes built with_main_thread, which are handed over to the thread blocked
+ * in syncWait(). When the task is run by another kind of coroutine, there is
+ * no such thread and they are created like the others.
+ *
+ * Callbacks may return any awaitable, including std::future<T>, which is
+ * then waited for by a helper thread. Helper threads are joined once done,
+ * or when the program exits at the latest. Like with parallelEnsureExists(),
+ * nodes that have transient dependencies or dependencies to refine are
+ * rejected at compile time.
+ */
+template <typename Context, typename Node, typename Graph>
+Task asyncEnsureExists(Context& ctx, Node, Graph);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, task (private)]
+
+struct Task::promise_type {
+	std::coroutine_handle<> continuation = std::noop_coroutine();
+	std::exception_ptr error;
+
+	// The state of the syncWait() that runs the task, if any, which tasks
+	// pass on to the tasks they await
+	detail::SyncWaitState* syncWait = nullptr;
+
+	struct FinalAwaiter {
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+			return handle.promise().continuation;
+		}
+		void await_resume() const noexcept {}
+	};
+
+	Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+	std::suspend_always initial_suspend() const noexcept { return {}; }
+	FinalAwaiter final_suspend() const noexcept { return {}; }
+	void return_void() const noexcept {}
+	void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+inline Task::Task(std::coroutine_handle<promise_type> handle) noexcept
+	: m_handle(handle)
+{}
+
+inline Task::Task(Task&& other) noexcept
+	: m_handle(std::exchange(other.m_handle, nullptr))
+{}
+
+inline Task& Task::operator=(Task&& other) noexcept {
+	if (this != &other) {
+		if (m_handle) m_handle.destroy();
+		m_handle = std::exchange(other.m_handle, nullptr);
+	}
+	return *this;
+}
+
+inline Task::~Task() {
+	if (m_handle) m_handle.destroy();
+}
+
+// Awaiters only refer to the awaited object, since some compilers copy the
+// operand of co_await when it is given directly as an awaiter.
+struct Task::Awaiter {
+	std::coroutine_handle<promise_type> handle;
+
+	bool await_ready() const noexcept {
+		return !handle || handle.done();
+	}
+
+	template <typename Promise>
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiter) noexcept {
+		if constexpr (std::is_same_v<Promise, promise_type>) {
+			handle.promise().syncWait = awaiter.promise().syncWait;
+		}
+		handle.promise().continuation = awaiter;
+		return handle;
+	}
+
+	void await_resume() const {
+		if (handle && handle.promise().error) {
+			std::rethrow_exception(handle.promise().error);
+		}
+	}
+};
+
+inline Task::Awaiter Task::operator co_await() const noexcept {
+	return { m_handle };
+}
+
+namespace detail {
+
+// An eagerly started coroutine that nobody awaits, and which frees itself
+// when done. Exceptions are expected to be caught by the coroutine's body.
+struct Detached {
+	struct promise_type {
+		Detached get_return_object() const noexcept { return {}; }
+		std::suspend_never initial_suspend() const noexcept { return {}; }
+		std::suspend_never final_suspend() const noexcept { return {}; }
+		void return_void() const noexcept {}
+		void unhandled_exception() const noexcept { std::terminate(); }
+	};
+};
+
+// The thread blocked in syncWait() resumes the coroutines posted to its
+// queue until the task is done.
+struct SyncWaitState {
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool done = false;
+	std::exception_ptr error;
+	std::thread::id thread = std::this_thread::get_id();
+	std::vector<std::coroutine_handle<>> queue;
+
+	void post(std::coroutine_handle<> handle) {
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(handle);
+		condition.notify_all();
+	}
+};
+
+// Resume the awaiting coroutine on the thread blocked in syncWait(), if any
+struct ResumeOnSyncWait {
+	SyncWaitState* state;
+
+	bool await_ready() const noexcept {
+		return state == nullptr || state->thread == std::this_thread::get_id();
+	}
+
+	void await_suspend(std::coroutine_handle<> awaiter) const {
+		state->post(awaiter);
+	}
+
+	void await_resume() const noexcept {}
+};
+
+// The state of the syncWait() that runs the awaiting task, without
+// suspending it
+struct CurrentSyncWait {
+	SyncWaitState* state = nullptr;
+
+	bool await_ready() const noexcept { return false; }
+
+	bool await_suspend(std::coroutine_handle<Task::promise_type> awaiter) noexcept {
+		state = awaiter.promise().syncWait;
+		return false;
+	}
+
+	SyncWaitState* await_resume() const noexcept { return state; }
+};
+
+inline Detached syncWaitImpl(Task task, SyncWaitState& state) {
+	try {
+		co_await task;
+	}
+	catch (...) {
+		state.error = std::current_exception();
+	}
+	// Notify while holding the lock, since the waiting thread destroys the
+	// state as soon as it sees it done.
+	std::lock_guard<std::mutex> lock(state.mutex);
+	state.done = true;
+	state.condition.notify_all();
+}
+
+} // namespace detail
+
+inline void syncWait(Task task) {
+	detail::SyncWaitState state;
+	if (task.m_handle) task.m_handle.promise().syncWait = &state;
+	detail::syncWaitImpl(std::move(task), state);
+	std::unique_lock<std::mutex> lock(state.mutex);
+	for (;;) {
+		state.condition.wait(lock, [&state] { return state.done || !state.queue.empty(); });
+		if (state.queue.empty()) break;
+		std::vector<std::coroutine_handle<>> handles;
+		handles.swap(state.queue);
+		lock.unlock();
+		for (std::coroutine_handle<> handle : handles) {
+			handle.resume();
+		}
+		lock.lock();
+	}
+	if (state.error) std::rethrow_exception(state.error);
+}
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, async algorithms (private)]
+
+namespace detail {
+
+/**
+ * An event that coroutines can wait for, and which resumes them once set.
+ * Waiters are resumed by the thread that sets the event.
+ */
+class AsyncEvent {
+public:
+	struct Awaiter {
+		AsyncEvent& event;
+
+		bool await_ready() const {
+			std::lock_guard<std::mutex> lock(event.m_mutex);
+			return event.m_set;
+		}
+
+		bool await_suspend(std::coroutine_handle<> waiter) const {
+			std::lock_guard<std::mutex> lock(event.m_mutex);
+			if (event.m_set) return false;
+			event.m_waiters.push_back(waiter);
+			return true;
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	Awaiter operator co_await() noexcept { return { *this }; }
+
+	// This object may be destroyed by one of the resumed waiters, so it must
+	// not be touched after resuming them.
+	void set() {
+		std::vector<std::coroutine_handle<>> waiters;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_set = true;
+			waiters.swap(m_waiters);
+		}
+		for (std::coroutine_handle<> waiter : waiters) {
+			waiter.resume();
+		}
+	}
+
+private:
+	std::mutex m_mutex;
+	bool m_set = false;
+	std::vector<std::coroutine_handle<>> m_waiters;
+};
+
+/**
+ * The helper threads that wait for futures. Each one is joined by the next
+ * one to start once it is done, or when the program exits at the latest, so
+ * that none of them outlives main().
+ */
+class FutureWaiters {
+public:
+	~FutureWaiters() {
+		// Threads that are still running may start new ones
+		for (;;) {
+			std::list<Waiter> waiters;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				waiters.swap(m_waiters);
+			}
+			if (waiters.empty()) break;
+			for (Waiter& waiter : waiters) {
+				waiter.thread.join();
+			}
+		}
+	}
+
+	template <typename Function>
+	void start(Function function) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto it = m_waiters.begin(); it != m_waiters.end();) {
+			if (it->done) {
+				it->thread.join();
+				it = m_waiters.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		Waiter& waiter = m_waiters.emplace_back();
+		waiter.thread = std::thread([&done = waiter.done, function = std::move(function)] {
+			function();
+			done = true;
+		});
+	}
+
+private:
+	struct Waiter {
+		std::thread thread;
+		std::atomic<bool> done{ false };
+	};
+
+	std::mutex m_mutex;
+	std::list<Waiter> m_waiters;
+};
+
+inline FutureWaiters& futureWaiters() {
+	static FutureWaiters waiters;
+	return waiters;
+}
+
+template <typename T>
+struct FutureAwaiter {
+	std::future<T> future;
+
+	bool await_ready() const {
+		return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	void await_suspend(std::coroutine_handle<> awaiter) {
+		futureWaiters().start([this, awaiter] {
+			future.wait();
+			awaiter.resume();
+		});
+	}
+
+	T await_resume() { return future.get(); }
+};
+
+// Futures are not awaitable by themselves, other types are left untouched
+template <typename Awaitable>
+Awaitable&& awaitable(Awaitable&& value) {
+	return std::forward<Awaitable>(value);
+}
+
+template <typename T>
+FutureAwaiter<T> awaitable(std::future<T>&& future) {
+	return { std::move(future) };
+}
+
+template <typename Context, typename Node>
+void markReady(Context& ctx) {
+	if constexpr (Node::UseReadyState()) {
+		Node::ReadyState(ctx) = true;
+	}
+}
+
+template <typename Awaitable, typename Context>
+Task awaitCreation(Awaitable creation, Context& ctx, void (*onReady)(Context&)) {
+	co_await std::move(creation);
+	onReady(ctx);
+}
+
+// NB: Node options are resolved in this regular function, so that the
+// coroutine bodies do not depend on the node type.
+template <typename Context, typename Node>
+Task createResourceAsync(Context& ctx, Node) {
+	if constexpr (Node::template HasOption<AsyncCreateOption>()) {
+		if (doesResourceExist(ctx, Node{}, false)) return Task();
+		constexpr auto fn = Node::template Option<AsyncCreateOption>::function;
+		if constexpr (Node::HasNoContext::value) {
+			return awaitCreation(awaitable(fn()), ctx, &markReady<Context, Node>);
+		}
+		else {
+			return awaitCreation(awaitable((ctx.*fn)()), ctx, &markReady<Context, Node>);
+		}
+	}
+	else {
+		createResource(ctx, Node{});
+		return Task();
+	}
+}
+
+// Shared state of the nodes of an asynchronous traversal
+template <std::size_t Count>
+struct AsyncTraversal {
+	std::array<AsyncEvent, Count> ready;
+	AsyncEvent done;
+	std::atomic<std::size_t> remaining{ Count };
+	std::mutex mutex;
+	std::exception_ptr error;
+	SyncWaitState* syncWait = nullptr;
+
+	bool failed() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return static_cast<bool>(error);
+	}
+
+	void fail(std::exception_ptr exception) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error) error = exception;
+	}
+
+	void finishOne() {
+		if (remaining.fetch_sub(1) == 1) done.set();
+	}
+};
+
+// Wait for the dependencies of the k-th node of the plan, given as the range
+// of graph indices [first, last), then create it, on the thread blocked in
+// syncWait() if it must run on the main thread. The node is marked as ready
+// even if it failed, so that its dependees do not wait forever, but they are
+// not created.
+template <typename Context, typename Node, std::size_t Count>
+Detached createNodeAsync(
+	Context& ctx,
+	AsyncTraversal<Count>& state,
+	std::size_t k,
+	const std::size_t* first,
+	const std::size_t* last,
+	const std::size_t* local
+) {
+	for (const std::size_t* dependency = first; dependency != last; ++dependency) {
+		co_await state.ready[local[*dependency]];
+	}
+	if constexpr (Node::RunsOnMainThread()) {
+		co_await ResumeOnSyncWait{ state.syncWait };
+	}
+	if (!state.failed()) {
+		try {
+			co_await createResourceAsync(ctx, Node{});
+		}
+		catch (...) {
+			state.fail(std::current_exception());
+		}
+	}
+	state.ready[k].set();
+	state.finishOne();
+}
+
+template <typename Context, typename Tables, const auto& Plan, std::size_t... Ks>
+void startNodes(Context& ctx, AsyncTraversal<Plan.nodes.size()>& state, std::index_sequence<Ks...>) {
+	const std::size_t* dependencies = Tables::dependencies.data();
+	(createNodeAsync<Context, BindNode<typename Tables::template NodeAt<Plan.nodes[Ks]>, Tables>>(
+		ctx, state, Ks,
+		dependencies + Tables::dependencyOffsets[Plan.nodes[Ks]],
+		dependencies + Tables::dependencyOffsets[Plan.nodes[Ks] + 1],
+		Plan.local.data()
+	), ...);
+}
+
+// All nodes are started in topological order, and run until they wait for
+// a dependency (or for their own asynchronous creation).
+template <typename Context, typename Tables, const auto& Plan>
+Task ensureExistsAsync(Context& ctx) {
+	AsyncTraversal<Plan.nodes.size()> state;
+	state.syncWait = co_await CurrentSyncWait{};
+	startNodes<Context, Tables, Plan>(ctx, state, std::make_index_sequence<Plan.nodes.size()>{});
+	co_await state.done;
+	if (state.error) std::rethrow_exception(state.error);
+}
+
+} // namespace detail
+
+// asyncEnsureExists()
+
+template <typename Context, typename Node, typename Graph>
+Task asyncEnsureExists(Context& ctx, Node, Graph) {
+	using Tables = typename Graph::Tables;
+	constexpr std::size_t I = Tables::template IndexOf<Node>;
+
+	if constexpr (I == Tables::NodeCount) {
+		// The node is not part of the graph, it has no dependency
+		return detail::createResourceAsync(ctx, Node{});
+	}
+	else {
+		static_assert(detail::allowsConcurrencyOf<Tables, detail::ensurePlan<Tables, I>>, "Nodes with transient dependencies or dependencies to refine (see with_levels) cannot be created concurrently, use ensureExists()");
+		return detail::ensureExistsAsync<Context, Tables, detail::ensurePlan<Tables, I>>(ctx);
+	}
+}
+
+#pragma endregion
+
+} // namespace statdeps
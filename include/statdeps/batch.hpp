@@ -0,0 +1,329 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "boundnode.hpp"
+#include "algorithms.hpp"
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * Same as ensureExists() for each context of a range (e.g., an array of
+ * viewports that all use the same graph), but node by node: each node of the
+ * closure is created for all contexts before moving on to the next one, so
+ * that its code stays hot. When the closure shares a ReadyStore, the
+ * readiness of all contexts is first checked with one mask test each.
+ *
+ * Nodes without context keep their state in global variables, so they are
+ * shared by all contexts, and only created once.
+ */
+template <typename Contexts, typename Node, typename Graph>
+constexpr void batchEnsureExists(Contexts& contexts, Node, Graph);
+
+/**
+ * Same as rebuild() for each context of a range, node by node like
+ * batchEnsureExists(). Nodes without context are rebuilt once for all: they
+ * are destroyed once all contexts have destroyed their dependees, and
+ * created before any context creates them again.
+ *
+ * When some of the affected nodes can be updated in place or have a
+ * fingerprint (see with_update and with_fingerprint), what is rebuilt
+ * depends on each context, so contexts are rebuilt one after the other, as
+ * if rebuild() were called on each of them. Nodes without context cannot be
+ * affected then, since each context would rebuild them again.
+ */
+template <typename Contexts, typename Node, typename Graph>
+constexpr void batchRebuild(Contexts& contexts, Node, Graph);
+
+template <typename Contexts, typename... Nodes, typename Graph>
+constexpr void batchRebuild(Contexts& contexts, List<Nodes...>, Graph);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+// Contexts are rebuilt by batches of this size, so that whether each node
+// existed in each context fits on the stack, unless nodes without context are
+// affected (see batchRebuildShared())
+inline constexpr std::size_t BatchSize = 64;
+
+template <typename Contexts>
+using BatchContext = std::remove_reference_t<decltype(*std::begin(std::declval<Contexts&>()))>;
+
+// Call a function on each context of a batch. Nodes without context share
+// their state, so they are only handled once, with the first context of the
+// first batch.
+template <typename Node, typename Context, typename Function>
+constexpr void forEachContext(Context* const* contexts, std::size_t count, bool firstBatch, Function&& function) {
+	if constexpr (Node::HasNoContext::value) {
+		if (firstBatch && count > 0) function(*contexts[0], std::size_t(0));
+	}
+	else {
+		for (std::size_t c = 0; c < count; ++c) function(*contexts[c], c);
+	}
+}
+
+// Call a function on each batch of pointers to the contexts of a range
+template <typename Contexts, typename Function>
+constexpr void forEachBatch(Contexts& contexts, Function&& function) {
+	std::array<BatchContext<Contexts>*, BatchSize> batch{};
+	std::size_t count = 0;
+	bool first = true;
+	for (auto& ctx : contexts) {
+		batch[count++] = &ctx;
+		if (count == BatchSize) {
+			function(batch.data(), count, first);
+			count = 0;
+			first = false;
+		}
+	}
+	if (count > 0) function(batch.data(), count, first);
+}
+
+template <typename Context, typename Tables, typename Roots, typename... Affected, std::size_t... Is>
+constexpr void batchRebuildUnion(Context* const* contexts, std::size_t count, bool firstBatch, Roots, List<Affected...>, std::index_sequence<Is...>) {
+	constexpr std::size_t Count = sizeof...(Affected);
+
+	// Same steps as rebuildUnion(), each of them for all contexts at once
+	std::array<std::array<bool, Count>, BatchSize> existed{};
+	auto checkExistence = [&](auto k) {
+		constexpr std::size_t K = decltype(k)::value;
+		using Node = TypeAt<K, Affected...>;
+		for (std::size_t c = 0; c < count; ++c) {
+			existed[c][K] = contains(Roots{}, Node{}) || doesResourceExist(*contexts[c], BindNode<Node, Tables>{}, true);
+		}
+	};
+	auto destroyAll = [&](auto k) {
+		constexpr std::size_t K = Count - 1 - decltype(k)::value;
+		using Node = TypeAt<K, Affected...>;
+		forEachContext<Node>(contexts, count, firstBatch, [&existed](Context& ctx, std::size_t c) {
+			destroyAffected<contains(Roots{}, Node{})>(ctx, BindNode<Node, Tables>{}, existed[c][K]);
+		});
+	};
+	auto createAll = [&](auto k) {
+		constexpr std::size_t K = decltype(k)::value;
+		using Node = TypeAt<K, Affected...>;
+		forEachContext<Node>(contexts, count, firstBatch, [&existed](Context& ctx, std::size_t c) {
+			createMissingResource(ctx, BindNode<Node, Tables>{}, existed[c][K]);
+			traceRebuilt<Tables, contains(Roots{}, Node{})>(ctx, Node{}, existed[c][K]);
+		});
+	};
+	(checkExistence(std::integral_constant<std::size_t, Is>{}), ...);
+	(destroyAll(std::integral_constant<std::size_t, Is>{}), ...);
+	(createAll(std::integral_constant<std::size_t, Is>{}), ...);
+	(void)checkExistence;
+	(void)destroyAll;
+	(void)createAll;
+}
+
+template <typename Context, typename Tables, typename Roots, typename... Affected>
+constexpr void batchRebuildUnion(Context* const* contexts, std::size_t count, bool firstBatch, Roots, List<Affected...>) {
+	if constexpr ((needsCutoff<Affected>() || ...)) {
+		static_assert(!(Affected::HasNoContext::value || ...), "Nodes without context cannot be rebuilt by batchRebuild() when nodes with_update or with_fingerprint are affected");
+		constexpr auto& order = indicesOf<Tables, Affected...>;
+		for (std::size_t c = 0; c < count; ++c) {
+			rebuildWithCutoff<Context, Tables>(*contexts[c], order.data(), order.size(), rootFlagsOf<Tables, Roots>);
+		}
+	}
+	else {
+		batchRebuildUnion<Context, Tables>(contexts, count, firstBatch, Roots{}, List<Affected...>{}, std::index_sequence_for<Affected...>{});
+	}
+}
+
+// Whether the nodes without context among the affected ones only depend on
+// affected nodes that have no context either, so that they can be destroyed
+// after and created before all the nodes that have one
+template <typename Tables, typename... Affected>
+constexpr bool sharedNodesComeFirst() {
+	constexpr std::size_t Count = sizeof...(Affected);
+	constexpr std::array<std::size_t, Count> indices = { Tables::template IndexOf<Affected>... };
+	constexpr std::array<bool, Count> shared = { Affected::HasNoContext::value... };
+	for (std::size_t k = 0; k < Count; ++k) {
+		if (!shared[k] || indices[k] == Tables::NodeCount) continue;
+		for (std::size_t e = Tables::dependencyOffsets[indices[k]]; e < Tables::dependencyOffsets[indices[k] + 1]; ++e) {
+			for (std::size_t j = 0; j < Count; ++j) {
+				if (indices[j] == Tables::dependencies[e] && !shared[j]) return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Same as batchRebuildUnion(), when nodes without context are affected. Their
+ * dependees in all batches must be destroyed before them and created after
+ * them, so the contexts of the range are gone through twice: first to
+ * destroy the nodes that have a context, batch by batch, then to create them
+ * again, while nodes without context are rebuilt in between. Since whether
+ * each node existed must be kept from the first pass to the second one, it
+ * is stored for all contexts.
+ */
+template <typename Tables, typename Roots, typename Contexts, typename... Affected, std::size_t... Is>
+void batchRebuildShared(Contexts& contexts, Roots, List<Affected...>, std::index_sequence<Is...>) {
+	static_assert(sharedNodesComeFirst<Tables, Affected...>(), "Nodes without context cannot depend on nodes with a context in batchRebuild()");
+	using Context = BatchContext<Contexts>;
+	constexpr std::size_t Count = sizeof...(Affected);
+
+	Context* first = nullptr;
+	std::array<bool, Count> sharedExisted{};
+	std::vector<std::array<bool, Count>> existed;
+
+	// Check existence then destroy the nodes that have a context, by batch
+	std::size_t offset = 0;
+	forEachBatch(contexts, [&](Context* const* batch, std::size_t count, bool firstBatch) {
+		if (firstBatch) first = batch[0];
+		existed.resize(offset + count);
+		auto checkExistence = [&](auto k) {
+			constexpr std::size_t K = decltype(k)::value;
+			using Node = TypeAt<K, Affected...>;
+			if constexpr (Node::HasNoContext::value) {
+				if (firstBatch) sharedExisted[K] = contains(Roots{}, Node{}) || doesResourceExist(*first, BindNode<Node, Tables>{}, true);
+			}
+			else {
+				for (std::size_t c = 0; c < count; ++c) {
+					existed[offset + c][K] = contains(Roots{}, Node{}) || doesResourceExist(*batch[c], BindNode<Node, Tables>{}, true);
+				}
+			}
+		};
+		auto destroyAll = [&](auto k) {
+			constexpr std::size_t K = Count - 1 - decltype(k)::value;
+			using Node = TypeAt<K, Affected...>;
+			if constexpr (!Node::HasNoContext::value) {
+				for (std::size_t c = 0; c < count; ++c) {
+					destroyAffected<contains(Roots{}, Node{})>(*batch[c], BindNode<Node, Tables>{}, existed[offset + c][K]);
+				}
+			}
+		};
+		(checkExistence(std::integral_constant<std::size_t, Is>{}), ...);
+		(destroyAll(std::integral_constant<std::size_t, Is>{}), ...);
+		offset += count;
+	});
+	if (!first) return;
+
+	// Rebuild the nodes without context once for all
+	auto destroyShared = [&](auto k) {
+		constexpr std::size_t K = Count - 1 - decltype(k)::value;
+		using Node = TypeAt<K, Affected...>;
+		if constexpr (Node::HasNoContext::value) {
+			destroyAffected<contains(Roots{}, Node{})>(*first, BindNode<Node, Tables>{}, sharedExisted[K]);
+		}
+	};
+	auto createShared = [&](auto k) {
+		constexpr std::size_t K = decltype(k)::value;
+		using Node = TypeAt<K, Affected...>;
+		if constexpr (Node::HasNoContext::value) {
+			createMissingResource(*first, BindNode<Node, Tables>{}, sharedExisted[K]);
+			traceRebuilt<Tables, contains(Roots{}, Node{})>(*first, Node{}, sharedExisted[K]);
+		}
+	};
+	(destroyShared(std::integral_constant<std::size_t, Is>{}), ...);
+	(createShared(std::integral_constant<std::size_t, Is>{}), ...);
+
+	// Create the nodes that have a context again, by batch
+	offset = 0;
+	forEachBatch(contexts, [&](Context* const* batch, std::size_t count, bool) {
+		auto createAll = [&](auto k) {
+			constexpr std::size_t K = decltype(k)::value;
+			using Node = TypeAt<K, Affected...>;
+			if constexpr (!Node::HasNoContext::value) {
+				for (std::size_t c = 0; c < count; ++c) {
+					createMissingResource(*batch[c], BindNode<Node, Tables>{}, existed[offset + c][K]);
+					traceRebuilt<Tables, contains(Roots{}, Node{})>(*batch[c], Node{}, existed[offset + c][K]);
+				}
+			}
+		};
+		(createAll(std::integral_constant<std::size_t, Is>{}), ...);
+		offset += count;
+	});
+}
+
+// Whether nodes without context are affected, and rebuilt once for all
+// contexts by batchRebuildShared()
+template <typename... Affected>
+constexpr bool rebuildsSharedNodes(List<Affected...>) {
+	return (Affected::HasNoContext::value || ...) && !(needsCutoff<Affected>() || ...);
+}
+
+template <typename Tables, typename Roots, typename Contexts, typename... Affected>
+void batchRebuildShared(Contexts& contexts, Roots, List<Affected...>) {
+	batchRebuildShared<Tables>(contexts, Roots{}, List<Affected...>{}, std::index_sequence_for<Affected...>{});
+}
+
+} // namespace detail
+
+template <typename Contexts, typename Node, typename Graph>
+constexpr void batchEnsureExists(Contexts& contexts, Node, Graph) {
+	using Tables = typename Graph::Tables;
+	using Context = detail::BatchContext<Contexts>;
+	auto closure = append(allDependencies(Node{}, Graph{}), Node{});
+	detail::forEachBatch(contexts, [&closure](Context* const* batch, std::size_t count, bool first) {
+		if constexpr (detail::closureSharesReadyStore<Tables, Node>()) {
+			bool allReady = true;
+			for (std::size_t c = 0; c < count; ++c) {
+				allReady &= isClosureReady(*batch[c], Node{}, Graph{});
+			}
+			if (allReady) {
+				for (std::size_t c = 0; c < count; ++c) {
+					forEach(closure, [&ctx = *batch[c]](auto node) { detail::traceExisting<Tables, Node>(ctx, node); });
+				}
+				return;
+			}
+		}
+		forEach(closure, [batch, count, first](auto node) {
+			detail::forEachContext<decltype(node)>(batch, count, first, [](Context& ctx, std::size_t) {
+				detail::ensureNodeExists<Tables, Node>(ctx, decltype(node){});
+			});
+		});
+	});
+}
+
+template <typename Contexts, typename Node, typename Graph>
+constexpr void batchRebuild(Contexts& contexts, Node, Graph) {
+	batchRebuild(contexts, List<Node>{}, Graph{});
+}
+
+template <typename Contexts, typename... Nodes, typename Graph>
+constexpr void batchRebuild(Contexts& contexts, List<Nodes...>, Graph) {
+	using Tables = typename Graph::Tables;
+	using Context = detail::BatchContext<Contexts>;
+	using Affected = typename Tables::template DependeeUnionOf<Nodes...>;
+	if constexpr (detail::rebuildsSharedNodes(Affected{})) {
+		detail::batchRebuildShared<Tables>(contexts, List<Nodes...>{}, Affected{});
+	}
+	detail::forEachBatch(contexts, [](Context* const* batch, std::size_t count, bool first) {
+		if constexpr (!detail::rebuildsSharedNodes(Affected{})) {
+			detail::batchRebuildUnion<Context, Tables>(batch, count, first, List<Nodes...>{}, Affected{});
+		}
+
+		// Nodes that are not part of the graph have no dependee
+		auto rebuildAlone = [batch, count, first](auto node) {
+			if constexpr (Tables::template IndexOf<decltype(node)> == Tables::NodeCount) {
+				detail::forEachContext<decltype(node)>(batch, count, first, [](Context& ctx, std::size_t) {
+					if (!updateResource(ctx, decltype(node){})) {
+						destroyResource(ctx, decltype(node){});
+						createResource(ctx, decltype(node){});
+					}
+				});
+			}
+		};
+		(rebuildAlone(Nodes{}), ...);
+		(void)rebuildAlone;
+	});
+}
+
+#pragma endregion
+
+} // namespace statdeps
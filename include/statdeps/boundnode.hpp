@@ -0,0 +1,469 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "readystore.hpp"
+#include "nodename.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+#include <type_traits>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+// Some options only make sense within a graph: the bit of a ReadyStore is
+// the index of the node, outputs are passed along edges, and cache keys
+// depend on the fingerprints of dependencies.
+template <typename Node>
+constexpr bool needsBinding() {
+	return Node::template HasOption<ReadyStoreOption>() || Node::template HasOption<OutputOption>() || Node::template HasOption<CacheOption>();
+}
+
+// Fingerprint of a node (see with_fingerprint), or 0 if it has none
+template <typename Node, typename Context>
+constexpr std::uint64_t fingerprintOf(Context& ctx) {
+	if constexpr (Node::template HasOption<FingerprintOption>()) {
+		constexpr auto fn = Node::template Option<FingerprintOption>::function;
+		if constexpr (Node::HasNoContext::value) {
+			return fn();
+		}
+		else {
+			return (ctx.*fn)();
+		}
+	}
+	else {
+		return 0;
+	}
+}
+
+constexpr std::uint64_t hashCombine(std::uint64_t seed, std::uint64_t value) noexcept {
+	return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// FNV-1a, to tell apart the entries of different nodes in a same cache
+constexpr std::uint64_t hashName(std::string_view name) noexcept {
+	std::uint64_t hash = 14695981039346656037ull;
+	for (char c : name) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Storage of the output of a node
+template <typename Node, typename Context>
+constexpr auto& outputOf(Context& ctx) {
+	constexpr auto storage = Node::template Option<OutputOption>::storage;
+	if constexpr (Node::HasNoContext::value) {
+		return *storage;
+	}
+	else {
+		return ctx.*storage;
+	}
+}
+
+template <typename Tables, typename Tag, std::size_t... Is>
+constexpr std::array<bool, sizeof...(Is)> optionFlags(std::index_sequence<Is...>) {
+	return { Tables::template NodeAt<Is>::template HasOption<Tag>()... };
+}
+
+template <typename Tables, typename Tag>
+inline constexpr auto optionFlagsOf = optionFlags<Tables, Tag>(std::make_index_sequence<Tables::NodeCount>{});
+
+template <typename Tables, std::size_t I, typename Tag>
+constexpr std::size_t dependencyCountWith() {
+	std::size_t count = 0;
+	for (std::size_t e = Tables::dependencyOffsets[I]; e < Tables::dependencyOffsets[I + 1]; ++e) {
+		if (optionFlagsOf<Tables, Tag>[Tables::dependencies[e]]) ++count;
+	}
+	return count;
+}
+
+// Indices of the direct dependencies of the node at index I that have the
+// option identified by Tag, in edge declaration order
+template <typename Tables, std::size_t I, typename Tag>
+inline constexpr auto dependenciesWith = [] {
+	std::array<std::size_t, dependencyCountWith<Tables, I, Tag>()> indices{};
+	std::size_t k = 0;
+	for (std::size_t e = Tables::dependencyOffsets[I]; e < Tables::dependencyOffsets[I + 1]; ++e) {
+		if (optionFlagsOf<Tables, Tag>[Tables::dependencies[e]]) indices[k++] = Tables::dependencies[e];
+	}
+	return indices;
+}();
+
+// Whether all direct dependencies of the node at index I that have an output
+// (see with_output) also have a fingerprint, so that the cache key of the
+// node changes whenever its inputs do (see with_cache)
+template <typename Tables, std::size_t I>
+constexpr bool outputsHaveFingerprints() {
+	for (std::size_t e = Tables::dependencyOffsets[I]; e < Tables::dependencyOffsets[I + 1]; ++e) {
+		const std::size_t dependency = Tables::dependencies[e];
+		if (optionFlagsOf<Tables, OutputOption>[dependency] && !optionFlagsOf<Tables, FingerprintOption>[dependency]) return false;
+	}
+	return true;
+}
+
+template <typename Tables, std::size_t I, std::size_t Excluded>
+constexpr std::size_t otherDependeeCount() {
+	std::size_t count = 0;
+	for (std::size_t e = Tables::dependeeOffsets[I]; e < Tables::dependeeOffsets[I + 1]; ++e) {
+		if (Tables::dependees[e] != Excluded) ++count;
+	}
+	return count;
+}
+
+// Indices of the direct dependees of the node at index I, except the one at
+// index Excluded
+template <typename Tables, std::size_t I, std::size_t Excluded>
+inline constexpr auto otherDependees = [] {
+	std::array<std::size_t, otherDependeeCount<Tables, I, Excluded>()> indices{};
+	std::size_t k = 0;
+	for (std::size_t e = Tables::dependeeOffsets[I]; e < Tables::dependeeOffsets[I + 1]; ++e) {
+		if (Tables::dependees[e] != Excluded) indices[k++] = Tables::dependees[e];
+	}
+	return indices;
+}();
+
+// Number of levels of a node (see with_levels), 1 for nodes that are ready
+// as soon as they are created
+template <typename Node>
+constexpr std::size_t levelCountOf() {
+	if constexpr (Node::template HasOption<LevelsOption>()) {
+		return Node::template Option<LevelsOption>::Count;
+	}
+	else {
+		return 1;
+	}
+}
+
+template <typename Tables, std::size_t... Is>
+constexpr std::array<std::size_t, sizeof...(Is)> levelCounts(std::index_sequence<Is...>) {
+	return { levelCountOf<typename Tables::template NodeAt<Is>>()... };
+}
+
+template <typename Tables>
+inline constexpr auto levelCountsOf = levelCounts<Tables>(std::make_index_sequence<Tables::NodeCount>{});
+
+// Level that the dependency of the e-th entry of the dependencies table
+// must reach before creating its dependee
+template <typename Tables>
+constexpr std::size_t requiredLevel(std::size_t e) {
+	const std::size_t count = levelCountsOf<Tables>[Tables::dependencies[e]];
+	return Tables::dependencyLevels[e] < count ? Tables::dependencyLevels[e] : count;
+}
+
+template <typename Tables, std::size_t I>
+constexpr std::size_t refinedDependencyCount() {
+	std::size_t count = 0;
+	for (std::size_t e = Tables::dependencyOffsets[I]; e < Tables::dependencyOffsets[I + 1]; ++e) {
+		if (requiredLevel<Tables>(e) > 1) ++count;
+	}
+	return count;
+}
+
+struct LevelRequirement {
+	std::size_t node = 0;
+	std::size_t level = 0;
+};
+
+// Direct dependencies of the node at index I that must be refined beyond
+// their first level before creating it
+template <typename Tables, std::size_t I>
+inline constexpr auto refinedDependencies = [] {
+	std::array<LevelRequirement, refinedDependencyCount<Tables, I>()> requirements{};
+	std::size_t k = 0;
+	for (std::size_t e = Tables::dependencyOffsets[I]; e < Tables::dependencyOffsets[I + 1]; ++e) {
+		if (requiredLevel<Tables>(e) > 1) requirements[k++] = { Tables::dependencies[e], requiredLevel<Tables>(e) };
+	}
+	return requirements;
+}();
+
+template <typename Tables, typename Node>
+constexpr bool hasRefinedDependency() {
+	constexpr std::size_t I = Tables::template IndexOf<Node>;
+	if constexpr (I == Tables::NodeCount) {
+		return false;
+	}
+	else {
+		return refinedDependencyCount<Tables, I>() > 0;
+	}
+}
+
+template <typename Tables, typename Node>
+constexpr bool hasTransientDependency() {
+	constexpr std::size_t I = Tables::template IndexOf<Node>;
+	if constexpr (I == Tables::NodeCount) {
+		return false;
+	}
+	else {
+		return dependencyCountWith<Tables, I, TransientOption>() > 0;
+	}
+}
+
+// Whether the nodes of a plan may be created concurrently (see parallel.hpp
+// and async.hpp). Dependees acquire and release their transient dependencies,
+// and refine their progressive dependencies (see with_levels), without
+// synchronization, so they must be created one at a time.
+template <typename Tables, const auto& Plan, std::size_t... Ks>
+constexpr bool allowsConcurrency(std::index_sequence<Ks...>) {
+	return ((!hasTransientDependency<Tables, typename Tables::template NodeAt<Plan.nodes[Ks]>>() && !hasRefinedDependency<Tables, typename Tables::template NodeAt<Plan.nodes[Ks]>>()) && ...);
+}
+
+template <typename Tables, const auto& Plan>
+inline constexpr bool allowsConcurrencyOf = allowsConcurrency<Tables, Plan>(std::make_index_sequence<Plan.nodes.size()>{});
+
+template <typename Node, typename Tables, bool = needsBinding<Node>() || hasTransientDependency<Tables, Node>() || hasRefinedDependency<Tables, Node>()>
+struct BindNodeImpl;
+
+// The type on which graph algorithms call node operations
+template <typename Node, typename Tables>
+using BindNode = typename BindNodeImpl<Node, Tables>::Type;
+
+struct GraphBoundTag {};
+
+/**
+ * A node seen from a graph, which is what graph algorithms call node
+ * operations on rather than the node itself, for nodes that have options
+ * that need the graph (see needsBinding()), or transient or progressive
+ * dependencies:
+ *  - with_ready_store: the ready state is the bit at the index of the node,
+ *  - with_output: the node is created by calling its producer with the
+ *    outputs of its dependencies,
+ *  - with_cache: the node is restored from the cache if possible, with a
+ *    key that depends on the fingerprints of its dependencies,
+ *  - with_transient dependencies are created before creating or updating
+ *    the node if they were released, and released afterwards once all of
+ *    their dependees that are not transient themselves exist,
+ *  - with_levels dependencies are refined before creating the node, up to
+ *    the level that its edges require.
+ */
+template <typename Node, typename Tables>
+struct GraphBoundNode : Node, GraphBoundTag {
+	static constexpr std::size_t Index = Tables::template IndexOf<Node>;
+	static_assert(Index < Tables::NodeCount, "Nodes with_ready_store, with_output or with_cache must be part of the graph");
+	static_assert(!Node::template HasOption<OutputOption>() || !Node::UseCreate(), "Nodes with_output are created by their producer, they cannot have a create callback");
+	static_assert(!Node::template HasOption<ReadyStoreOption>() || !Node::template HasOption<OnceStateOption>(), "Nodes cannot have both with_ready_store and with_once_state");
+	static_assert(!Node::template HasOption<LevelsOption>() || !Node::template HasOption<ReadyStoreOption>(), "Nodes cannot have both with_ready_store and with_levels");
+	static_assert(!Node::template HasOption<CacheOption>() || Node::UseCreate() || Node::template HasOption<OutputOption>(), "Nodes with_cache must have a create callback or be with_output");
+	static_assert(!Node::template HasOption<CacheOption>() || !Node::template HasOption<OutputOption>() || outputsHaveFingerprints<Tables, Index>(), "The outputs that a node with_cache receives must come from nodes with_fingerprint, otherwise its cache key would not change with them");
+
+	template <typename Context>
+	static constexpr auto& Store(Context& ctx) {
+		constexpr auto store = Node::template Option<ReadyStoreOption>::member;
+		if constexpr (Node::HasNoContext::value) {
+			return *store;
+		}
+		else {
+			return ctx.*store;
+		}
+	}
+
+	static constexpr bool UseReadyState() {
+		return Node::template HasOption<ReadyStoreOption>() || Node::UseReadyState();
+	}
+
+	template <typename Context>
+	static constexpr decltype(auto) ReadyState(Context& ctx) {
+		if constexpr (Node::template HasOption<ReadyStoreOption>()) {
+			static_assert(Tables::NodeCount <= std::remove_reference_t<decltype(Store(ctx))>::Capacity, "The ReadyStore is too small for this graph");
+			return Store(ctx)[Index];
+		}
+		else {
+			return Node::ReadyState(ctx);
+		}
+	}
+
+	static constexpr bool UseCreate() {
+		return Node::UseCreate() || Node::template HasOption<OutputOption>();
+	}
+
+	template <typename Context>
+	static constexpr void Create(Context& ctx) {
+		acquireTransients(ctx, std::make_index_sequence<TransientDependencies.size()>{});
+		refineDependencies(ctx, std::make_index_sequence<RefinedDependencies.size()>{});
+		if constexpr (Node::template HasOption<CacheOption>()) {
+			const std::uint64_t key = cacheKey(ctx, std::make_index_sequence<FingerprintedDependencies.size()>{});
+			if (!cacheOf(ctx).restore(key, [&ctx](std::string_view bytes) { return deserialize(ctx, bytes); })) {
+				createUncached(ctx);
+				const auto& bytes = serialize(ctx);
+				cacheOf(ctx).store(key, std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size() * sizeof(*bytes.data())));
+			}
+		}
+		else {
+			createUncached(ctx);
+		}
+		releaseTransients(ctx, std::make_index_sequence<TransientDependencies.size()>{});
+	}
+
+	template <typename Context>
+	static constexpr void Destroy(Context& ctx) {
+		Node::Destroy(ctx);
+		if constexpr (Node::template HasOption<OutputOption>()) {
+			using Value = std::remove_reference_t<decltype(outputOf<Node>(ctx))>;
+			outputOf<Node>(ctx) = Value{};
+		}
+	}
+
+	// Call the update callback (see with_update). Transient dependencies are
+	// kept when it fails, since the node is then created again.
+	template <typename Context>
+	static constexpr bool Update(Context& ctx) {
+		acquireTransients(ctx, std::make_index_sequence<TransientDependencies.size()>{});
+		if (!updateExistingResource(ctx, Node{})) return false;
+		releaseTransients(ctx, std::make_index_sequence<TransientDependencies.size()>{});
+		return true;
+	}
+
+private:
+	static constexpr auto& TransientDependencies = dependenciesWith<Tables, Index, TransientOption>;
+	static constexpr auto& FingerprintedDependencies = dependenciesWith<Tables, Index, FingerprintOption>;
+	static constexpr auto& RefinedDependencies = refinedDependencies<Tables, Index>;
+
+	template <typename Context>
+	static constexpr void createUncached(Context& ctx) {
+		if constexpr (Node::template HasOption<OutputOption>()) {
+			constexpr std::size_t Count = dependenciesWith<Tables, Index, OutputOption>.size();
+			outputOf<Node>(ctx) = produce(ctx, std::make_index_sequence<Count>{});
+		}
+		else {
+			Node::Create(ctx);
+		}
+	}
+
+	// Callbacks of with_cache
+
+	using CacheCallbacks = typename Node::template Option<CacheOption>;
+
+	template <typename Context>
+	static constexpr auto& cacheOf(Context& ctx) {
+		if constexpr (Node::HasNoContext::value) {
+			return *CacheCallbacks::member;
+		}
+		else {
+			return ctx.*CacheCallbacks::member;
+		}
+	}
+
+	template <typename Context, std::size_t... Ks>
+	static constexpr std::uint64_t cacheKey(Context& ctx, std::index_sequence<Ks...>) {
+		std::uint64_t key = hashName(nodeName(Node{}));
+		if constexpr (Node::HasNoContext::value) {
+			key = hashCombine(key, CacheCallbacks::key());
+		}
+		else {
+			key = hashCombine(key, (std::as_const(ctx).*CacheCallbacks::key)());
+		}
+		((key = hashCombine(key, fingerprintOf<typename Tables::template NodeAt<FingerprintedDependencies[Ks]>>(ctx))), ...);
+		return key;
+	}
+
+	template <typename Context>
+	static constexpr decltype(auto) serialize(Context& ctx) {
+		if constexpr (Node::HasNoContext::value) {
+			return CacheCallbacks::serialize();
+		}
+		else {
+			return (std::as_const(ctx).*CacheCallbacks::serialize)();
+		}
+	}
+
+	template <typename Context>
+	static constexpr bool deserialize(Context& ctx, std::string_view bytes) {
+		if constexpr (Node::HasNoContext::value) {
+			return CacheCallbacks::deserialize(bytes);
+		}
+		else {
+			return (ctx.*CacheCallbacks::deserialize)(bytes);
+		}
+	}
+
+	template <std::size_t I>
+	using BoundNodeAt = BindNode<typename Tables::template NodeAt<I>, Tables>;
+
+	template <typename Context, std::size_t... Ks>
+	static constexpr auto produce(Context& ctx, std::index_sequence<Ks...>) {
+		constexpr auto producer = Node::template Option<OutputOption>::function;
+		constexpr auto& dependencies = dependenciesWith<Tables, Index, OutputOption>;
+		if constexpr (Node::HasNoContext::value) {
+			return producer(std::as_const(outputOf<typename Tables::template NodeAt<dependencies[Ks]>>(ctx))...);
+		}
+		else {
+			return (ctx.*producer)(std::as_const(outputOf<typename Tables::template NodeAt<dependencies[Ks]>>(ctx))...);
+		}
+	}
+
+	// Dependencies exist at this point, but may not have reached the level
+	// required by the edges of this node yet (see with_levels)
+	template <typename Context, std::size_t... Ks>
+	static constexpr void refineDependencies(Context& ctx, std::index_sequence<Ks...>) {
+		auto refineTo = [&ctx](auto dependency, std::size_t level) {
+			using Dependency = BoundNodeAt<decltype(dependency)::value>;
+			while (Dependency::ReadyState(ctx) != 0 && Dependency::ReadyState(ctx) < level) {
+				refineResource(ctx, Dependency{});
+			}
+		};
+		(refineTo(std::integral_constant<std::size_t, RefinedDependencies[Ks].node>{}, RefinedDependencies[Ks].level), ...);
+		(void)refineTo;
+	}
+
+	template <typename Context, std::size_t... Ks>
+	static constexpr void acquireTransients(Context& ctx, std::index_sequence<Ks...>) {
+		(createResource(ctx, BoundNodeAt<TransientDependencies[Ks]>{}), ...);
+	}
+
+	// This node is not marked as created yet, but it does not need the
+	// transient dependency anymore, and neither do transient dependees,
+	// which create it again whenever they are needed.
+	template <std::size_t T, typename Context, std::size_t... Ks>
+	static constexpr bool othersExist(Context& ctx, std::index_sequence<Ks...>) {
+		constexpr auto& others = otherDependees<Tables, T, Index>;
+		constexpr auto& transient = optionFlagsOf<Tables, TransientOption>;
+		return ((transient[others[Ks]] || doesResourceExist(ctx, BoundNodeAt<others[Ks]>{}, true)) && ...);
+	}
+
+	template <typename Context, std::size_t... Ks>
+	static constexpr void releaseTransients(Context& ctx, std::index_sequence<Ks...>) {
+		auto release = [&ctx](auto transient) {
+			constexpr std::size_t T = decltype(transient)::value;
+			if (othersExist<T>(ctx, std::make_index_sequence<otherDependees<Tables, T, Index>.size()>{})) {
+				destroyResource(ctx, BoundNodeAt<T>{});
+			}
+		};
+		(release(std::integral_constant<std::size_t, TransientDependencies[Ks]>{}), ...);
+		(void)release;
+	}
+};
+
+template <typename Node, typename Tables, bool>
+struct BindNodeImpl {
+	using Type = Node;
+};
+
+template <typename Node, typename Tables>
+struct BindNodeImpl<Node, Tables, true> {
+	using Type = GraphBoundNode<Node, Tables>;
+};
+
+template <typename Tables, typename... Nodes>
+constexpr List<BindNode<Nodes, Tables>...> bindNodes(List<Nodes...>) noexcept {
+	return {};
+}
+
+// Nodes that need the graph can only be used through graph algorithms
+template <typename Node>
+constexpr bool needsGraph() {
+	return needsBinding<Node>() && !std::is_base_of_v<GraphBoundTag, Node>;
+}
+
+} // namespace detail
+
+#pragma endregion
+
+} // namespace statdeps
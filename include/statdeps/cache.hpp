@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A persistent cache for nodes built with_cache, that keeps each entry in a
+ * file of its own within a directory, so that it survives across runs. The
+ * cache is best effort: a file that cannot be read is a miss, and failing to
+ * write one only means that the resource is created again at the next run.
+ * Entries are written to a temporary file then renamed, so that a run that
+ * stops while writing does not leave a truncated entry behind.
+ *
+ * Entries are read into a buffer that is reused from one lookup to the next,
+ * so the cache must not be shared by threads that create resources
+ * concurrently. Stale entries are never removed, except by clear().
+ */
+class FileCache {
+public:
+	/**
+	 * The directory is created when storing the first entry. An empty path
+	 * disables the cache, which then always misses and stores nothing.
+	 */
+	explicit FileCache(std::filesystem::path directory);
+
+	const std::filesystem::path& directory() const { return m_directory; }
+
+	/**
+	 * If there is an entry for the key, call restore with its bytes, and
+	 * return whether it succeeded.
+	 */
+	template <typename Restore>
+	bool restore(std::uint64_t key, Restore&& restore);
+
+	void store(std::uint64_t key, std::string_view bytes);
+
+	/**
+	 * Remove all the entries
+	 */
+	void clear();
+
+	std::uint64_t hits() const { return m_hits; }
+	std::uint64_t misses() const { return m_misses; }
+
+private:
+	std::filesystem::path pathOf(std::uint64_t key) const;
+	bool read(const std::filesystem::path& path);
+
+private:
+	std::filesystem::path m_directory;
+	std::string m_buffer;
+	std::uint64_t m_hits = 0;
+	std::uint64_t m_misses = 0;
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+inline FileCache::FileCache(std::filesystem::path directory)
+	: m_directory(std::move(directory))
+{}
+
+template <typename Restore>
+bool FileCache::restore(std::uint64_t key, Restore&& restore) {
+	if (!m_directory.empty() && read(pathOf(key)) && restore(std::string_view(m_buffer))) {
+		++m_hits;
+		return true;
+	}
+	++m_misses;
+	return false;
+}
+
+inline void FileCache::store(std::uint64_t key, std::string_view bytes) {
+	if (m_directory.empty()) return;
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	if (error) return;
+
+	const std::filesystem::path path = pathOf(key);
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	std::FILE* file = std::fopen(temporary.string().c_str(), "wb");
+	if (!file) return;
+	const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	if (std::fclose(file) != 0 || !written) {
+		std::filesystem::remove(temporary, error);
+		return;
+	}
+	std::filesystem::rename(temporary, path, error);
+	if (error) std::filesystem::remove(temporary, error);
+}
+
+inline void FileCache::clear() {
+	if (m_directory.empty()) return;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(m_directory, error)) {
+		if (entry.path().extension() == ".bin") std::filesystem::remove(entry.path(), error);
+	}
+}
+
+inline std::filesystem::path FileCache::pathOf(std::uint64_t key) const {
+	constexpr char digits[] = "0123456789abcdef";
+	char name[16];
+	for (int k = 15; k >= 0; --k, key >>= 4) {
+		name[k] = digits[key & 0xf];
+	}
+	return m_directory / (std::string(name, sizeof(name)) + ".bin");
+}
+
+inline bool FileCache::read(const std::filesystem::path& path) {
+	std::FILE* file = std::fopen(path.string().c_str(), "rb");
+	if (!file) return false;
+	bool ok = std::fseek(file, 0, SEEK_END) == 0;
+	const long size = ok ? std::ftell(file) : -1;
+	ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+	if (ok) {
+		m_buffer.resize(static_cast<std::size_t>(size));
+		ok = std::fread(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size();
+	}
+	std::fclose(file);
+	return ok;
+}
+
+#pragma endregion
+
+} // namespace statdeps
@@ -1,8 +1,7 @@
 #pragma once
 
-#include <vector>
-#include <iostream>
-#include <functional>
+#include <cstddef>
+#include <type_traits>
 
 namespace statdeps {
 
@@ -12,6 +11,333 @@ namespace statdeps {
  */
 struct NoContext {};
 
+/**
+ * A utility type to represent list of nodes/edges/options
+ */
+template <typename... Elements>
+struct List {};
+
+/**
+ * Options are optional features of a node that only some algorithms care
+ * about. Each option is a type that either is or derives from the tag type
+ * that identifies it, and a node holds the list of its options (see
+ * DepsNodeBuilder::with_option).
+ */
+
+/**
+ * The resource must be created and destroyed on the thread that called the
+ * algorithm (e.g., because it calls into a GPU device), even when using
+ * parallel algorithms.
+ */
+struct MainThreadOption {};
+
+/**
+ * The resource is created by a callback that returns an awaitable (e.g., a
+ * coroutine task) rather than void, which only asyncEnsureExists() can call
+ * (see async.hpp). The callback is a member of the context, or a free
+ * function for nodes without context.
+ */
+struct AsyncCreateOption {};
+
+template <auto fn>
+struct AsyncCreate : AsyncCreateOption {
+	static constexpr auto function = fn;
+};
+
+/**
+ * The ready state of the resource is a bit of a ReadyStore (see
+ * readystore.hpp) shared by the nodes of a graph, rather than a bool of its
+ * own. The store is a member of the context, or a global variable for nodes
+ * without context, and the bit is the index of the node in the graph.
+ */
+struct ReadyStoreOption {};
+
+template <auto store>
+struct ReadyStoreMember : ReadyStoreOption {
+	static constexpr auto member = store;
+};
+
+/**
+ * The ready state of the resource is a OnceState (see oncestate.hpp) rather
+ * than a bool, so that several threads can call ensureExists() concurrently:
+ * each resource is created by only one of them, and the others only wait for
+ * the resources they need. The state is a member of the context, or a global
+ * variable for nodes without context, and it replaces with_ready_state.
+ */
+struct OnceStateOption {};
+
+template <auto state>
+struct OnceStateMember : OnceStateOption {
+	static constexpr auto member = state;
+};
+
+/**
+ * The resource can be updated in place when rebuilt, e.g., to upload new data
+ * to an existing texture of the same size, rather than destroyed and created
+ * again. The callback returns true if it could update the resource in place,
+ * in which case dependees are not rebuilt because of it, or false to fall
+ * back to destroying and creating it (having left the resource untouched).
+ *
+ * The callback is only called when the resource exists, once its rebuilt
+ * dependencies have been created again. Until then the resource is kept
+ * while they are destroyed, so it must not use them in the meantime.
+ * rebuild() and DirtySet::flush() use it, other algorithms ignore it.
+ */
+struct UpdateOption {};
+
+template <auto fn>
+struct Update : UpdateOption {
+	static constexpr auto function = fn;
+};
+
+/**
+ * A hash of the content of the resource, e.g., of the bytes of a file it was
+ * loaded from, as a std::uint64_t. When the node is rebuilt, its fingerprint
+ * is compared before and after creating it again, and if it did not change
+ * its dependees are not rebuilt because of it (early cutoff).
+ *
+ * Dependees are kept while the node is recreated, so they must only depend
+ * on its content, not on the resource itself (e.g., on a copy of the data).
+ * rebuild() and DirtySet::flush() use it, other algorithms ignore it.
+ */
+struct FingerprintOption {};
+
+template <auto fn>
+struct Fingerprint : FingerprintOption {
+	static constexpr auto function = fn;
+};
+
+/**
+ * The resource is a value returned by a producer callback, which receives
+ * the outputs of the direct dependencies that have one, by const reference
+ * and in the order their edges are declared in the graph. The value is
+ * moved into a storage member of the context (or a global variable for
+ * nodes without context), and reset to a default value when destroyed, after
+ * calling the destroy callback if any. Such nodes have no create callback.
+ *
+ *   ImageData loadImage();
+ *   wgpu::Texture makeTexture(const ImageData& image);
+ */
+struct OutputOption {};
+
+template <auto storageMember, auto producer>
+struct Output : OutputOption {
+	static constexpr auto storage = storageMember;
+	static constexpr auto function = producer;
+};
+
+/**
+ * The resource can be restored from a persistent cache (see cache.hpp) rather
+ * than created, e.g., to skip compiling a shader or decoding an image at
+ * startup when nothing changed since the last run. Before creating it, the
+ * node looks up the cache with a key that combines the name of the node, its
+ * key callback (e.g., a hash of a path and of a format version) and the
+ * fingerprints of its direct dependencies that have one (see
+ * with_fingerprint). On a hit, the deserialize callback restores the
+ * resource from the cached bytes like the create callback (or producer)
+ * would have created it. On a miss, or if it returns false, the resource is
+ * created as usual and the bytes returned by the serialize callback are
+ * stored in the cache. For nodes with_output, all the dependencies whose
+ * output is passed to the producer must have a fingerprint, so that the key
+ * changes with the inputs, which is checked at compile time:
+ *
+ *   std::uint64_t shaderKey() const;
+ *   std::string saveShader() const; // or any contiguous container of bytes
+ *   bool loadShader(std::string_view bytes);
+ *
+ * The cache is a member of the context, or a global variable for nodes
+ * without context, and is used through two functions:
+ *
+ *   template <typename Restore> // bool(std::string_view bytes)
+ *   bool restore(std::uint64_t key, Restore&& restore);
+ *   void store(std::uint64_t key, std::string_view bytes);
+ *
+ * Like with_ready_store, such nodes can only be used within a graph.
+ */
+struct CacheOption {};
+
+template <auto cacheMember, auto keyFn, auto serializeFn, auto deserializeFn>
+struct Cache : CacheOption {
+	static constexpr auto member = cacheMember;
+	static constexpr auto key = keyFn;
+	static constexpr auto serialize = serializeFn;
+	static constexpr auto deserialize = deserializeFn;
+};
+
+/**
+ * The resource becomes ready progressively, e.g., a texture whose low mip is
+ * uploaded first while the others are still streaming. Its ready state is a
+ * level rather than a bool: 0 when absent, 1 once created, and up to the
+ * given number of levels once complete. The refine callback raises the
+ * resource from a level to the next one, and receives the new level.
+ *
+ *   std::uint8_t m_textureLevel = 0;
+ *   void refineTexture(std::size_t level); // upload the next mip
+ *
+ * Each edge declares the minimum level of its dependency that the dependee
+ * needs (see DepsEdge), and dependencies are refined up to this level before
+ * creating the dependee. By default this is FullLevel, so dependees only get
+ * started on partial data if their edge says so, and the rest is refined by
+ * calling refine(), e.g., once per frame. The level is a member of the
+ * context, or a global variable for nodes without context, and it replaces
+ * with_ready_state. Dependees that require more than the first level refine
+ * the shared level themselves, so the parallel and asynchronous algorithms
+ * reject them at compile time.
+ */
+struct LevelsOption {};
+
+template <auto levelMember, std::size_t levelCount, auto refineFn>
+struct Levels : LevelsOption {
+	static_assert(levelCount >= 1, "A node has at least one level, where it is created");
+	static constexpr auto member = levelMember;
+	static constexpr std::size_t Count = levelCount;
+	static constexpr auto function = refineFn;
+};
+
+/**
+ * The resource is stored in a slot of a ResourcePool (see pool.hpp) rather
+ * than in a member of its own, e.g., when many contexts each have their own
+ * instance of the node (see batchEnsureExists). Creating the node constructs
+ * the value returned by the factory callback in place in a free slot, and
+ * destroying it calls the destroy callback if any then gives the slot back
+ * to the pool, to be reused by the next creation without allocating:
+ *
+ *   statdeps::ResourcePool<wgpu::Texture> m_textures;
+ *   statdeps::Handle<wgpu::Texture> m_texture;
+ *   wgpu::Texture makeTexture();
+ *
+ * The handle to the slot is a member of the context, or a global variable
+ * for nodes without context, and whether it is valid tells whether the
+ * resource exists. The pool is a member of the context, or a global variable
+ * (possibly shared by the contexts of a batch). Such nodes have no create
+ * callback.
+ */
+struct PoolOption {};
+
+template <auto poolMember, auto handleMember, auto factoryFn>
+struct Pool : PoolOption {
+	static constexpr auto pool = poolMember;
+	static constexpr auto handle = handleMember;
+	static constexpr auto factory = factoryFn;
+};
+
+/**
+ * The resource is only needed to create its dependees (e.g., pixel data read
+ * from a file to fill a texture), so it is destroyed as soon as all of its
+ * direct dependees exist, and created again only when one of them needs to
+ * be created or updated. ensureExists() does not create it for its own sake
+ * unless it is the requested node. A dependee that is transient too does not
+ * keep it alive, since it creates it again whenever it is needed.
+ *
+ * Once released, its fingerprint (see with_fingerprint) is not known anymore,
+ * so rebuilding it always affects its dependees. Its dependees must not be
+ * created concurrently with each other, since each of them decides whether
+ * it is the last one to need the resource, so the parallel and asynchronous
+ * algorithms reject graphs where they would be at compile time.
+ */
+struct TransientOption {};
+
+/**
+ * Operations on the node are reported to an instrumentation policy (see
+ * instrumentation.hpp), with timestamps, e.g., to forward them to a profiler.
+ * A policy is a type with the following static functions, called before and
+ * after each creation, destruction, update, refinement (see with_levels) and
+ * existence check, including when the operation throws:
+ *
+ *   struct MyInstrumentation {
+ *       template <typename Node>
+ *       static void onBegin(NodeEvent event, InstrumentationClock::time_point begin);
+ *       template <typename Node>
+ *       static void onEnd(NodeEvent event, InstrumentationClock::time_point begin, InstrumentationClock::time_point end);
+ *   };
+ *
+ * Nodes without this option are not instrumented at all, at no cost.
+ */
+struct InstrumentationOption {};
+
+template <typename PolicyType>
+struct Instrumentation : InstrumentationOption {
+	using Policy = PolicyType;
+};
+
+/**
+ * The decisions that ensureExists() and rebuild() take about the node, i.e.,
+ * whether it is created, rebuilt, updated or skipped and why, are recorded
+ * into a TraceBuffer (see trace.hpp). The buffer is a member of the context,
+ * or a global variable for nodes without context, and it can be shared by
+ * all the nodes of a graph. Nodes without this option record nothing.
+ */
+struct TraceOption {};
+
+template <auto buffer>
+struct TraceMember : TraceOption {
+	static constexpr auto member = buffer;
+};
+
+namespace detail {
+
+template <typename Tag, typename Option>
+struct OptionMatches : std::is_base_of<Tag, Option> {
+	using Type = Option;
+};
+
+struct OptionNotFound : std::true_type {
+	using Type = void;
+};
+
+// The first option of the list that derives from Tag, or void if none does
+template <typename Tag, typename Options>
+struct FindOption;
+
+template <typename Tag, typename... Options>
+struct FindOption<Tag, List<Options...>> {
+	using Type = typename std::disjunction<OptionMatches<Tag, Options>..., OptionNotFound>::Type;
+};
+
+template <typename Options, typename Option>
+struct AppendOption;
+
+template <typename... Options, typename Option>
+struct AppendOption<List<Options...>, Option> {
+	using Type = List<Options..., Option>;
+};
+
+// Pool and handle of a node built with_pool, which are either members of
+// the context or global variables
+template <auto member, typename Context>
+constexpr auto& poolMemberOf(Context& ctx) {
+	if constexpr (std::is_member_object_pointer_v<decltype(member)>) return ctx.*member;
+	else return *member;
+}
+
+template <typename Node, typename Context>
+constexpr void createPooled(Context& ctx) {
+	using Pooling = typename Node::template Option<PoolOption>;
+	auto& handle = poolMemberOf<Pooling::handle>(ctx);
+	if constexpr (Node::HasNoContext::value) {
+		handle = poolMemberOf<Pooling::pool>(ctx).emplaceWith(Pooling::factory);
+	}
+	else {
+		handle = poolMemberOf<Pooling::pool>(ctx).emplaceWith([&ctx]() { return (ctx.*Pooling::factory)(); });
+	}
+}
+
+template <typename Node, typename Context>
+constexpr void destroyPooled(Context& ctx) {
+	using Pooling = typename Node::template Option<PoolOption>;
+	auto& handle = poolMemberOf<Pooling::handle>(ctx);
+	poolMemberOf<Pooling::pool>(ctx).release(handle);
+	handle = {};
+}
+
+template <typename Node, typename Context>
+constexpr bool pooledExists(Context& ctx) {
+	using Pooling = typename Node::template Option<PoolOption>;
+	return poolMemberOf<Pooling::pool>(ctx).contains(poolMemberOf<Pooling::handle>(ctx));
+}
+
+} // namespace detail
+
 /**
  * A Dependency Node represents a resource, described by a way to initialize
  * and terminate it. This resource init/terminate can be tied to a specific
@@ -29,58 +355,108 @@ struct NoContext {};
  * this template class.
  * 
  * Warnings:
- *  - There is no security against circular dependencies
- *  - There is no security against race conditions
+ *  - There is no security against race conditions, unless the ready state
+ *    is a OnceState (see with_once_state)
  */
 template <
-	int N, // N is just an ID for pretty printing
-	typename Context, // The type of the Context from which init and terminate are members
-	void (Context::*createFn)(), // Create fonction, as a member of the context class
-	void (Context::*destroyFn)(), // Destroy fonction, as a member of the context class
-	bool (Context::*existsFn)() const, // Exists fonction, as a member of the context class
-	bool Context::*readyState, // Ready state, as a member of the context class
+	int N, // N is just an ID, to tell apart nodes that would otherwise be the same type
+	typename ContextType, // The type of the Context from which init and terminate are members
+	void (ContextType::*createFn)(), // Create fonction, as a member of the context class
+	void (ContextType::*destroyFn)(), // Destroy fonction, as a member of the context class
+	bool (ContextType::*existsFn)() const, // Exists fonction, as a member of the context class
+	bool ContextType::*readyState, // Ready state, as a member of the context class
 	void (*noContextCreateFn)(), // Create function that is used when Context is set to "NoContext"
 	void (*noContextDestroyFn)(), // Destroy function that is used when Context is set to "NoContext"
 	bool (*noContextExistsFn)(), // Exists function that is used when Context is set to "NoContext"
-	bool *noContextReadyState // Ready state that is used when Context is set to "NoContext"
+	bool *noContextReadyState, // Ready state that is used when Context is set to "NoContext"
+	typename OptionList = List<> // Optional features, see MainThreadOption and the like
 >
 struct DepsNode {
-	typedef Context Context;
-	static constexpr void PrettyPrint() { std::cout << "StaticDepsNode<" << N << ">" << std::endl; }
-
-	static constexpr void Create(Context& ctx) { if (createFn) (ctx.*createFn)(); }
-
-	static constexpr void Destroy(Context& ctx) { if (destroyFn) (ctx.*destroyFn)(); }
-
-	static constexpr bool UseExists() { return existsFn; }
-
-	static constexpr bool Exists(const Context& ctx) { static_assert(existsFn); return (ctx.*existsFn)(); }
-
-	static constexpr bool UseReadyState() { return readyState; }
+	using Context = ContextType;
+	static constexpr int Identifier = N;
+	using HasNoContext = std::is_same<Context, NoContext>;
 
-	static constexpr bool& ReadyState(Context& ctx) { static_assert(readyState); return ctx.*readyState; }
+	using Options = OptionList;
+
+	// The option identified by the given tag, or void if the node does not have it
+	template <typename Tag>
+	using Option = typename detail::FindOption<Tag, Options>::Type;
+
+	template <typename Tag>
+	static constexpr bool HasOption() { return !std::is_void_v<Option<Tag>>; }
+
+	static constexpr bool RunsOnMainThread() { return HasOption<MainThreadOption>(); }
+
+	static constexpr bool UseCreate() {
+		if constexpr (HasOption<PoolOption>()) return true;
+		else if constexpr (HasNoContext::value) return noContextCreateFn != nullptr;
+		else return createFn != nullptr;
+	}
+
+	static constexpr void Create(Context& ctx) {
+		if constexpr (HasOption<PoolOption>()) { static_assert(createFn == nullptr, "Nodes with_pool are created by their factory, they cannot have a create callback"); detail::createPooled<DepsNode>(ctx); }
+		else if constexpr (HasNoContext::value) { if constexpr (noContextCreateFn != nullptr) noContextCreateFn(); }
+		else { if constexpr (createFn != nullptr) (ctx.*createFn)(); }
+	}
+
+	static constexpr void Destroy(Context& ctx) {
+		if constexpr (HasNoContext::value) { if constexpr (noContextDestroyFn != nullptr) noContextDestroyFn(); }
+		else { if constexpr (destroyFn != nullptr) (ctx.*destroyFn)(); }
+		if constexpr (HasOption<PoolOption>()) detail::destroyPooled<DepsNode>(ctx);
+	}
+
+	static constexpr bool UseExists() {
+		if constexpr (HasOption<PoolOption>()) return true;
+		else if constexpr (HasNoContext::value) return noContextExistsFn != nullptr;
+		else return existsFn != nullptr;
+	}
+
+	static constexpr bool Exists(const Context& ctx) {
+		if constexpr (HasOption<PoolOption>()) return detail::pooledExists<DepsNode>(ctx);
+		else if constexpr (HasNoContext::value) { static_assert(noContextExistsFn); return noContextExistsFn(); }
+		else { static_assert(existsFn); return (ctx.*existsFn)(); }
+	}
+
+	static constexpr bool UseReadyState() {
+		if constexpr (HasOption<OnceStateOption>() || HasOption<LevelsOption>()) return true;
+		else if constexpr (HasNoContext::value) return noContextReadyState != nullptr;
+		else return readyState != nullptr;
+	}
+
+	// Either a bool, a OnceState (see with_once_state) or a level (see with_levels)
+	static constexpr decltype(auto) ReadyState(Context& ctx) {
+		if constexpr (HasOption<OnceStateOption>()) { if constexpr (HasNoContext::value) return (*Option<OnceStateOption>::member); else return (ctx.*Option<OnceStateOption>::member); }
+		else if constexpr (HasOption<LevelsOption>()) { if constexpr (HasNoContext::value) return (*Option<LevelsOption>::member); else return (ctx.*Option<LevelsOption>::member); }
+		else if constexpr (HasNoContext::value) { static_assert(noContextReadyState); return (*noContextReadyState); }
+		else { static_assert(readyState); return (ctx.*readyState); }
+	}
 
 	// If the node has no context, allow any context to be passed, and use the
 	// "no context" version of the create/destroy/exists functions.
-	using HasNoContext = std::is_same<Context, NoContext>;
-
-	template <typename AnyContext, typename = typename std::enable_if_t<HasNoContext::value>>
-	static constexpr void Create(AnyContext&) { if (noContextCreateFn) noContextCreateFn(); }
-
-	template <typename AnyContext, typename = typename std::enable_if_t<HasNoContext::value>>
-	static constexpr void Destroy(AnyContext&) { if (noContextDestroyFn) noContextDestroyFn(); }
-
-	template <typename = typename std::enable_if_t<HasNoContext::value>>
-	static constexpr bool UseExists() { return noContextExistsFn; }
-
-	template <typename AnyContext, typename = typename std::enable_if_t<HasNoContext::value>>
-	static constexpr bool Exists(const AnyContext&) { static_assert(noContextExistsFn); return noContextExistsFn(); }
-
-	template <typename = typename std::enable_if_t<HasNoContext::value>>
-	static constexpr bool UseReadyState() { return noContextReadyState; }
-
-	template <typename AnyContext, typename = typename std::enable_if_t<HasNoContext::value>>
-	static constexpr bool& ReadyState(AnyContext&) { static_assert(noContextReadyState); return *noContextReadyState; }
+	template <typename AnyContext, typename C = Context, typename = std::enable_if_t<std::is_same_v<C, NoContext>>>
+	static constexpr void Create(AnyContext& ctx) {
+		if constexpr (HasOption<PoolOption>()) { static_assert(noContextCreateFn == nullptr, "Nodes with_pool are created by their factory, they cannot have a create callback"); detail::createPooled<DepsNode>(ctx); }
+		else if constexpr (noContextCreateFn != nullptr) noContextCreateFn();
+	}
+
+	template <typename AnyContext, typename C = Context, typename = std::enable_if_t<std::is_same_v<C, NoContext>>>
+	static constexpr void Destroy(AnyContext& ctx) {
+		if constexpr (noContextDestroyFn != nullptr) noContextDestroyFn();
+		if constexpr (HasOption<PoolOption>()) detail::destroyPooled<DepsNode>(ctx);
+	}
+
+	template <typename AnyContext, typename C = Context, typename = std::enable_if_t<std::is_same_v<C, NoContext>>>
+	static constexpr bool Exists(const AnyContext& ctx) {
+		if constexpr (HasOption<PoolOption>()) return detail::pooledExists<DepsNode>(ctx);
+		else { static_assert(noContextExistsFn); return noContextExistsFn(); }
+	}
+
+	template <typename AnyContext, typename C = Context, typename = std::enable_if_t<std::is_same_v<C, NoContext>>>
+	static constexpr decltype(auto) ReadyState(AnyContext&) {
+		if constexpr (HasOption<OnceStateOption>()) return (*Option<OnceStateOption>::member);
+		else if constexpr (HasOption<LevelsOption>()) return (*Option<LevelsOption>::member);
+		else { static_assert(noContextReadyState); return (*noContextReadyState); }
+	}
 };
 
 /**
@@ -104,6 +480,12 @@ struct DepsNode {
  * The implementation is split into two state, depending on whether the
  * create/destroy/etc. function are members of a given Context class or if they
  * are simple functions.
+ *
+ * Optional features are added with with_option<SomeOption>, or with the
+ * dedicated shortcuts like with_main_thread, with_transient,
+ * with_async_create, with_ready_store, with_once_state, with_update,
+ * with_fingerprint, with_output, with_cache, with_levels, with_pool,
+ * with_instrumentation or with_trace.
  */
 template <
 	int N = 0,
@@ -111,84 +493,239 @@ template <
 	void (Context::* createFn)() = nullptr,
 	void (Context::* destroyFn)() = nullptr,
 	bool (Context::* existsFn)() const = nullptr,
-	bool Context::*readyState = nullptr
+	bool Context::*readyState = nullptr,
+	typename Options = List<>
 >
 struct DepsNodeBuilder_implWithContext {
 	template <int NewN>
-	using with_identifier = DepsNodeBuilder_implWithContext<NewN, Context, createFn, destroyFn, existsFn, readyState>;
+	using with_identifier = DepsNodeBuilder_implWithContext<NewN, Context, createFn, destroyFn, existsFn, readyState, Options>;
 
 	template <void (Context::*newCreateFn)()>
-	using with_create = DepsNodeBuilder_implWithContext<N, Context, newCreateFn, destroyFn, existsFn, readyState>;
+	using with_create = DepsNodeBuilder_implWithContext<N, Context, newCreateFn, destroyFn, existsFn, readyState, Options>;
 
 	template <void (Context::*newDestroyFn)()>
-	using with_destroy = DepsNodeBuilder_implWithContext<N, Context, createFn, newDestroyFn, existsFn, readyState>;
+	using with_destroy = DepsNodeBuilder_implWithContext<N, Context, createFn, newDestroyFn, existsFn, readyState, Options>;
 
 	template <bool (Context::*newExistsFn)() const>
-	using with_exists = DepsNodeBuilder_implWithContext<N, Context, createFn, destroyFn, newExistsFn, readyState>;
+	using with_exists = DepsNodeBuilder_implWithContext<N, Context, createFn, destroyFn, newExistsFn, readyState, Options>;
 
 	template <bool Context::*newReadyState>
-	using with_ready_state = DepsNodeBuilder_implWithContext<N, Context, createFn, destroyFn, existsFn, newReadyState>;
+	using with_ready_state = DepsNodeBuilder_implWithContext<N, Context, createFn, destroyFn, existsFn, newReadyState, Options>;
+
+	template <typename NewOption>
+	using with_option = DepsNodeBuilder_implWithContext<N, Context, createFn, destroyFn, existsFn, readyState, typename detail::AppendOption<Options, NewOption>::Type>;
+
+	using with_main_thread = with_option<MainThreadOption>;
+
+	using with_transient = with_option<TransientOption>;
+
+	template <auto newAsyncCreateFn>
+	using with_async_create = with_option<AsyncCreate<newAsyncCreateFn>>;
+
+	template <auto newStore>
+	using with_ready_store = with_option<ReadyStoreMember<newStore>>;
+
+	template <auto newState>
+	using with_once_state = with_option<OnceStateMember<newState>>;
+
+	template <typename NewPolicy>
+	using with_instrumentation = with_option<Instrumentation<NewPolicy>>;
 
-	using build = DepsNode<N, Context, createFn, destroyFn, existsFn, readyState, nullptr, nullptr, nullptr, nullptr>;
+	template <auto newBuffer>
+	using with_trace = with_option<TraceMember<newBuffer>>;
+
+	template <auto newLevel, std::size_t levelCount, auto newRefineFn>
+	using with_levels = with_option<Levels<newLevel, levelCount, newRefineFn>>;
+
+	template <auto newCache, auto newKeyFn, auto newSerializeFn, auto newDeserializeFn>
+	using with_cache = with_option<Cache<newCache, newKeyFn, newSerializeFn, newDeserializeFn>>;
+
+	template <auto newPool, auto newHandle, auto newFactoryFn>
+	using with_pool = with_option<Pool<newPool, newHandle, newFactoryFn>>;
+
+	template <auto newUpdateFn>
+	using with_update = with_option<Update<newUpdateFn>>;
+
+	template <auto newFingerprintFn>
+	using with_fingerprint = with_option<Fingerprint<newFingerprintFn>>;
+
+	template <auto newStorage, auto newProducer>
+	using with_output = with_option<Output<newStorage, newProducer>>;
+
+	using build = DepsNode<N, Context, createFn, destroyFn, existsFn, readyState, nullptr, nullptr, nullptr, nullptr, Options>;
 };
 template <
 	int N = 0,
 	void (*createFn)() = nullptr,
 	void (*destroyFn)() = nullptr,
 	bool (*existsFn)() = nullptr,
-	bool *readyState = nullptr
+	bool *readyState = nullptr,
+	typename Options = List<>
 >
 struct DepsNodeBuilder_implNoContext {
 	template <int NewN>
-	using with_identifier = DepsNodeBuilder_implNoContext<NewN, createFn, destroyFn, existsFn, readyState>;
+	using with_identifier = DepsNodeBuilder_implNoContext<NewN, createFn, destroyFn, existsFn, readyState, Options>;
 
 	template <typename NewContext, typename = typename std::enable_if_t<!std::is_same_v<NewContext, NoContext>>>
-	using with_context = DepsNodeBuilder_implWithContext<N, NewContext, nullptr, nullptr, nullptr, nullptr>;
+	using with_context = DepsNodeBuilder_implWithContext<N, NewContext, nullptr, nullptr, nullptr, nullptr, Options>;
 
 	template <void (*newCreateFn)()>
-	using with_create = DepsNodeBuilder_implNoContext<N, newCreateFn, destroyFn, existsFn, readyState>;
+	using with_create = DepsNodeBuilder_implNoContext<N, newCreateFn, destroyFn, existsFn, readyState, Options>;
 
 	template <void (*newDestroyFn)()>
-	using with_destroy = DepsNodeBuilder_implNoContext<N, createFn, newDestroyFn, existsFn, readyState>;
+	using with_destroy = DepsNodeBuilder_implNoContext<N, createFn, newDestroyFn, existsFn, readyState, Options>;
 
 	template <bool (*newExistsFn)()>
-	using with_exists = DepsNodeBuilder_implNoContext<N, createFn, destroyFn, newExistsFn, readyState>;
+	using with_exists = DepsNodeBuilder_implNoContext<N, createFn, destroyFn, newExistsFn, readyState, Options>;
 
 	template <bool *newReadyState>
-	using with_ready_state = DepsNodeBuilder_implNoContext<N, createFn, destroyFn, existsFn, newReadyState>;
+	using with_ready_state = DepsNodeBuilder_implNoContext<N, createFn, destroyFn, existsFn, newReadyState, Options>;
+
+	template <typename NewOption>
+	using with_option = DepsNodeBuilder_implNoContext<N, createFn, destroyFn, existsFn, readyState, typename detail::AppendOption<Options, NewOption>::Type>;
+
+	using with_main_thread = with_option<MainThreadOption>;
 
-	using build = DepsNode<N, NoContext, nullptr, nullptr, nullptr, nullptr, createFn, destroyFn, existsFn, readyState>;
+	using with_transient = with_option<TransientOption>;
+
+	template <auto newAsyncCreateFn>
+	using with_async_create = with_option<AsyncCreate<newAsyncCreateFn>>;
+
+	template <auto newStore>
+	using with_ready_store = with_option<ReadyStoreMember<newStore>>;
+
+	template <auto newState>
+	using with_once_state = with_option<OnceStateMember<newState>>;
+
+	template <typename NewPolicy>
+	using with_instrumentation = with_option<Instrumentation<NewPolicy>>;
+
+	template <auto newBuffer>
+	using with_trace = with_option<TraceMember<newBuffer>>;
+
+	template <auto newLevel, std::size_t levelCount, auto newRefineFn>
+	using with_levels = with_option<Levels<newLevel, levelCount, newRefineFn>>;
+
+	template <auto newCache, auto newKeyFn, auto newSerializeFn, auto newDeserializeFn>
+	using with_cache = with_option<Cache<newCache, newKeyFn, newSerializeFn, newDeserializeFn>>;
+
+	template <auto newPool, auto newHandle, auto newFactoryFn>
+	using with_pool = with_option<Pool<newPool, newHandle, newFactoryFn>>;
+
+	template <auto newUpdateFn>
+	using with_update = with_option<Update<newUpdateFn>>;
+
+	template <auto newFingerprintFn>
+	using with_fingerprint = with_option<Fingerprint<newFingerprintFn>>;
+
+	template <auto newStorage, auto newProducer>
+	using with_output = with_option<Output<newStorage, newProducer>>;
+
+	using build = DepsNode<N, NoContext, nullptr, nullptr, nullptr, nullptr, createFn, destroyFn, existsFn, readyState, Options>;
 };
 using DepsNodeBuilder = DepsNodeBuilder_implNoContext<>;
 
 /**
- * The type DepsEdge<A,B> means "A depends on B"
+ * Minimum level of a dependency required by an edge when it does not say,
+ * i.e., the last level of nodes built with_levels.
  */
-template <typename A, typename B>
+inline constexpr std::size_t FullLevel = static_cast<std::size_t>(-1);
+
+/**
+ * The type DepsEdge<A,B> means "A depends on B". When B is built with_levels,
+ * A is only created once B reached MinLevel (e.g., DepsEdge<A, B, 1> lets A
+ * start as soon as B is created), otherwise MinLevel is ignored.
+ */
+template <typename A, typename B, std::size_t MinLevel = FullLevel>
 struct DepsEdge {
 	using Dependee = A;
 	using Dependency = B;
+	static constexpr std::size_t Level = MinLevel;
 };
 
+namespace detail {
+
+template <typename T>
+struct IsList : std::false_type {};
+
+template <typename... Elements>
+struct IsList<List<Elements...>> : std::true_type {};
+
+template <typename T>
+struct IsEdge : std::false_type {};
+
+template <typename A, typename B, std::size_t MinLevel>
+struct IsEdge<DepsEdge<A, B, MinLevel>> : std::true_type {};
+
+template <typename T>
+struct IsEdgeList : std::false_type {};
+
+template <typename... Edges>
+struct IsEdgeList<List<Edges...>> : std::bool_constant<(IsEdge<Edges>::value && ...)> {};
+
+} // namespace detail
+
 /**
- * A utility type to represent list of nodes/edges
+ * Flattened, index-based representation of a graph (see graphtables.hpp)
  */
-template <typename... Elements>
-struct List {};
+template <typename Graph>
+struct GraphTables;
 
 /**
  * The top-level type representing a dependency graph, including nodes and edges.
  * 
- * NB: Currently, the list of nodes is never used, so you may leave it empty.
- *     In practice node list is inferred from the edge list.
+ * NB: The list of nodes is only used to assign the first node indices, so you
+ *     may leave it empty. In practice node list is inferred from the edge list.
  * 
- * NB: Ns and Es must have the form List<...> (TODO: raise a static error if not)
+ * NB: Ns and Es must have the form List<...>, and edges the form DepsEdge<A, B>.
+ *     Graphs that contain a cycle are rejected when their tables are built
+ *     (see GraphTables), with the nodes of the cycle in the error message.
  */
 template <typename Ns, typename Es>
 struct DepsGraph {
+	static_assert(detail::IsList<Ns>::value, "The node list of a DepsGraph must have the form List<...>");
+	static_assert(detail::IsList<Es>::value, "The edge list of a DepsGraph must have the form List<...>");
+	static_assert(!detail::IsList<Es>::value || detail::IsEdgeList<Es>::value, "The edges of a DepsGraph must have the form DepsEdge<A, B>");
+
 	using NodeList = Ns;
 	using EdgeList = Es;
+	using Tables = GraphTables<DepsGraph>;
 };
 
+namespace detail {
+
+template <typename... Graphs>
+struct JoinGraphs;
+
+template <typename... Ns, typename... Es>
+struct JoinGraphs<DepsGraph<List<Ns...>, List<Es...>>> {
+	using Type = DepsGraph<List<Ns...>, List<Es...>>;
+};
+
+template <typename... Ns1, typename... Es1, typename... Ns2, typename... Es2, typename... Graphs>
+struct JoinGraphs<DepsGraph<List<Ns1...>, List<Es1...>>, DepsGraph<List<Ns2...>, List<Es2...>>, Graphs...>
+	: JoinGraphs<DepsGraph<List<Ns1..., Ns2...>, List<Es1..., Es2...>>, Graphs...>
+{};
+
+} // namespace detail
+
+/**
+ * A graph made of several subgraphs, e.g. one declared next to the code of
+ * each part of an application (device, pipelines, textures...). A node that
+ * appears in several subgraphs is a single node of the joined graph, and the
+ * edges that link subgraphs together can be given as one more subgraph:
+ *
+ *     using Graph = JoinGraphs<DeviceGraph, PipelineGraph, DepsGraph<List<>, List<
+ *         DepsEdge<PipelineResource, DeviceResource>
+ *     >>>;
+ *
+ * Node lists come first, in the order of the subgraphs, then edges in the same
+ * order. Edges are not deduplicated: an edge declared in several subgraphs
+ * appears several times in the tables, which the algorithms tolerate, but is
+ * best declared in a single one. The tables of the joined graph are computed
+ * once like for any other graph, independently of those of its subgraphs.
+ */
+template <typename... Graphs>
+using JoinGraphs = typename detail::JoinGraphs<Graphs...>::Type;
 
 } // namespace statdeps
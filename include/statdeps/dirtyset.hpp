@@ -0,0 +1,162 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "algorithms.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A set of nodes of a graph that must be rebuilt, stored as a bitset of one
+ * bit per node. Invalidating a node only marks it, and flush() rebuilds all
+ * marked nodes at once, so that invalidating the same node several times,
+ * or several nodes with shared dependees, only rebuilds each resource once.
+ *
+ *   m_dirty.invalidate(PathResource{}); // e.g., each time the path changes
+ *   m_dirty.flush(*this); // once per frame
+ *
+ * Flushing is equivalent to calling rebuild() with the list of nodes that
+ * were invalidated since the last flush.
+ */
+template <typename Graph>
+class DirtySet;
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+template <typename Graph>
+class DirtySet {
+private:
+	using Tables = typename Graph::Tables;
+	static constexpr std::size_t NodeCount = Tables::NodeCount;
+	static constexpr std::size_t WordCount = (NodeCount + 63) / 64;
+	using Bits = std::array<std::uint64_t, WordCount>;
+
+public:
+	/**
+	 * Mark a node, and as a consequence all of its dependees, for rebuild
+	 */
+	template <typename Node>
+	void invalidate(Node) {
+		constexpr std::size_t i = Tables::template IndexOf<Node>;
+		static_assert(i < NodeCount, "Only nodes that are part of the graph can be invalidated");
+		set(m_bits, i);
+	}
+
+	template <typename Node>
+	bool isDirty(Node) const {
+		constexpr std::size_t i = Tables::template IndexOf<Node>;
+		if constexpr (i < NodeCount) return test(m_bits, i);
+		else return false;
+	}
+
+	bool empty() const {
+		for (std::uint64_t word : m_bits) {
+			if (word != 0) return false;
+		}
+		return true;
+	}
+
+	void clear() {
+		m_bits = Bits{};
+	}
+
+	/**
+	 * Rebuild all invalidated nodes and their dependees, each at most once,
+	 * and clear the set. If a callback throws, the invalidated nodes stay in
+	 * the set, so that the next flush rebuilds them again.
+	 */
+	template <typename Context>
+	void flush(Context& ctx) {
+		if (empty()) return;
+		const Bits dirty = m_bits;
+		clear();
+		try {
+			rebuild(ctx, dirty);
+		}
+		catch (...) {
+			// Keep the nodes invalidated meanwhile too
+			for (std::size_t w = 0; w < WordCount; ++w) m_bits[w] |= dirty[w];
+			throw;
+		}
+	}
+
+private:
+	template <typename Context>
+	static void rebuild(Context& ctx, const Bits& dirty) {
+		using Operations = detail::NodeOperations<Context, Tables>;
+		constexpr auto& order = Tables::topologicalOrder;
+
+		if constexpr (Operations::anyCutoff) {
+			std::array<bool, NodeCount> roots{};
+			for (std::size_t i = 0; i < NodeCount; ++i) roots[i] = test(dirty, i);
+			detail::rebuildWithCutoff<Context, Tables>(ctx, order.data(), Tables::SortedCount, roots);
+			return;
+		}
+
+		// A node is affected if it is dirty or if one of its dependencies is,
+		// which is known once all of them have been visited.
+		Bits affected = dirty;
+		for (std::size_t k = 0; k < Tables::SortedCount; ++k) {
+			std::size_t i = order[k];
+			for (std::size_t e = Tables::dependencyOffsets[i]; e < Tables::dependencyOffsets[i + 1]; ++e) {
+				if (test(affected, Tables::dependencies[e])) {
+					set(affected, i);
+					break;
+				}
+			}
+		}
+
+		// Same as rebuild(), where dirty nodes are the rebuilt ones
+		std::array<bool, NodeCount> existed{};
+		for (std::size_t k = 0; k < Tables::SortedCount; ++k) {
+			std::size_t i = order[k];
+			if (test(affected, i)) existed[i] = test(dirty, i) || Operations::exists[i](ctx);
+		}
+		for (std::size_t k = Tables::SortedCount; k-- > 0;) {
+			std::size_t i = order[k];
+			if (!test(affected, i)) continue;
+			if (test(dirty, i)) Operations::destroy[i](ctx, true);
+			else Operations::destroyExisting[i](ctx, existed[i]);
+		}
+		for (std::size_t k = 0; k < Tables::SortedCount; ++k) {
+			std::size_t i = order[k];
+			if (test(affected, i)) Operations::createMissing[i](ctx, existed[i]);
+		}
+
+		if constexpr (Operations::anyTraced) {
+			for (std::size_t k = 0; k < Tables::SortedCount; ++k) {
+				std::size_t i = order[k];
+				if (!test(affected, i)) continue;
+				if (test(dirty, i)) Operations::trace[i](ctx, TraceAction::Rebuilt, TraceReason::Requested);
+				else if (existed[i]) Operations::trace[i](ctx, TraceAction::Rebuilt, TraceReason::DependencyChanged);
+				else Operations::trace[i](ctx, TraceAction::Skipped, TraceReason::Missing);
+			}
+		}
+	}
+
+	static bool test(const Bits& bits, std::size_t i) {
+		return (bits[i / 64] >> (i % 64)) & 1;
+	}
+
+	static void set(Bits& bits, std::size_t i) {
+		bits[i / 64] |= std::uint64_t(1) << (i % 64);
+	}
+
+private:
+	Bits m_bits{};
+};
+
+#pragma endregion
+
+} // namespace statdeps
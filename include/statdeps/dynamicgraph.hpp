@@ -0,0 +1,419 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "algorithms.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * The callbacks of a node of a DynamicDepsGraph, which mirror the ones of a
+ * DepsNode but are given at runtime, together with a user pointer (e.g., to
+ * the asset the node stands for). When there is no exists callback, the
+ * graph keeps track of the ready state of the node itself.
+ */
+template <typename Context>
+struct DynamicNode {
+	void (*create)(Context& ctx, void* user) = nullptr;
+	void (*destroy)(Context& ctx, void* user) = nullptr;
+	bool (*exists)(Context& ctx, void* user) = nullptr;
+	void* user = nullptr;
+};
+
+/**
+ * A dependency graph whose nodes and edges are added at runtime, e.g., one
+ * node per loaded asset, with the same operations as the static algorithms.
+ *
+ * The topological order is maintained incrementally as edges are added, and
+ * traversals run on a flat CSR adjacency indexed by position in this order,
+ * rebuilt after each change of the graph, so that they only scan contiguous
+ * arrays. Adding an edge that would close a cycle is refused.
+ *
+ * A whole dynamic graph can be used as a single node of a static graph (see
+ * DynamicSubgraphNode), so that the static parts keep their static code.
+ */
+template <typename Context>
+class DynamicDepsGraph;
+
+/**
+ * A node of a static graph that stands for all the nodes of a dynamic graph
+ * that is a member of the context. Creating it creates all of them, and
+ * destroying it destroys all of them, so e.g. a static bind group that
+ * depends on it is rebuilt whenever one of its static dependencies is.
+ */
+template <typename Context, DynamicDepsGraph<Context> Context::*graph>
+struct DynamicSubgraphNode;
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+// Callbacks of a static node, to add it to a dynamic graph
+template <typename Context, typename Node>
+struct StaticNodeCallbacks {
+	static void create(Context& ctx, void*) { createMissingResource(ctx, Node{}, true); }
+	static void destroy(Context& ctx, void*) { destroyExistingResource(ctx, Node{}, true); }
+	static bool exists(Context& ctx, void*) { return doesResourceExist(ctx, Node{}, false); }
+};
+
+} // namespace detail
+
+template <typename Context>
+class DynamicDepsGraph {
+public:
+	using NodeId = std::uint32_t;
+
+	/**
+	 * Add a node without any edge, and return its identifier
+	 */
+	NodeId addNode(const DynamicNode<Context>& node);
+
+	/**
+	 * Add a static node (see DepsNode), using its own ready state or exists
+	 * callback if it has one
+	 */
+	template <typename Node>
+	NodeId addNode(Node);
+
+	/**
+	 * Make a node depend on another one. Return false, and leave the graph
+	 * untouched, if this would create a cycle.
+	 */
+	bool addEdge(NodeId dependee, NodeId dependency);
+
+	/**
+	 * Destroy a node and its dependees, then remove it and its edges. Its
+	 * identifier may be reused by a node added later on.
+	 */
+	void removeNode(Context& ctx, NodeId node);
+
+	std::size_t nodeCount() const { return m_order.size(); }
+
+	bool exists(Context& ctx, NodeId node) const;
+
+	/**
+	 * Same as the static ensureExists(), rebuild() and destroyResource()
+	 */
+	void ensureExists(Context& ctx, NodeId node);
+	void rebuild(Context& ctx, NodeId node);
+	void destroy(Context& ctx, NodeId node);
+
+	/**
+	 * Create/destroy all nodes, in (reverse) topological order
+	 */
+	void createAll(Context& ctx);
+	void destroyAll(Context& ctx);
+	bool allExist(Context& ctx) const;
+
+private:
+	struct Record {
+		DynamicNode<Context> callbacks;
+		std::vector<NodeId> dependencies;
+		std::vector<NodeId> dependees;
+		std::uint32_t position = 0;
+		bool ready = false;
+	};
+
+	bool existsAt(Context& ctx, std::uint32_t position) const;
+	void createAt(Context& ctx, std::uint32_t position);
+	void destroyAt(Context& ctx, std::uint32_t position);
+
+	// The nodes reachable from a node in a direction, among the ones that are
+	// positioned within the given bounds (inclusive)
+	std::vector<NodeId> collect(NodeId start, std::vector<NodeId> Record::*next, std::uint32_t low, std::uint32_t high);
+
+	void updateAdjacency();
+
+private:
+	std::vector<Record> m_records;
+	std::vector<NodeId> m_freeIds;
+
+	// Node at each position of the topological order
+	std::vector<NodeId> m_order;
+
+	// Dependencies by position in topological order, as CSR
+	bool m_adjacencyDirty = true;
+	std::vector<std::uint32_t> m_dependencyOffsets;
+	std::vector<std::uint32_t> m_dependencies;
+
+	// Scratch buffers, kept to avoid allocations in traversals
+	std::vector<char> m_marks; // by position
+	std::vector<char> m_existed; // by position
+	std::vector<char> m_visited; // by node, always cleared after use
+};
+
+// Node management
+
+template <typename Context>
+typename DynamicDepsGraph<Context>::NodeId DynamicDepsGraph<Context>::addNode(const DynamicNode<Context>& node) {
+	NodeId id;
+	if (m_freeIds.empty()) {
+		id = static_cast<NodeId>(m_records.size());
+		m_records.emplace_back();
+	}
+	else {
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	Record& record = m_records[id];
+	record = Record{};
+	record.callbacks = node;
+
+	// A node without edges can be anywhere in the order
+	record.position = static_cast<std::uint32_t>(m_order.size());
+	m_order.push_back(id);
+	m_adjacencyDirty = true;
+	return id;
+}
+
+template <typename Context>
+template <typename Node>
+typename DynamicDepsGraph<Context>::NodeId DynamicDepsGraph<Context>::addNode(Node) {
+	DynamicNode<Context> node;
+	node.create = &detail::StaticNodeCallbacks<Context, Node>::create;
+	node.destroy = &detail::StaticNodeCallbacks<Context, Node>::destroy;
+	if constexpr (Node::UseReadyState() || Node::UseExists()) {
+		node.exists = &detail::StaticNodeCallbacks<Context, Node>::exists;
+	}
+	return addNode(node);
+}
+
+// Edges are added while maintaining the topological order as described by
+// Pearce and Kelly: when the dependency is after the dependee, only nodes
+// positioned between them are reordered, namely the dependees of the
+// dependee and the dependencies of the dependency, keeping their positions.
+template <typename Context>
+bool DynamicDepsGraph<Context>::addEdge(NodeId dependee, NodeId dependency) {
+	if (dependee == dependency) return false;
+	const std::vector<NodeId>& existing = m_records[dependee].dependencies;
+	if (std::find(existing.begin(), existing.end(), dependency) != existing.end()) return true;
+
+	const std::uint32_t low = m_records[dependee].position;
+	const std::uint32_t high = m_records[dependency].position;
+	if (low < high) {
+		std::vector<NodeId> forward = collect(dependee, &Record::dependees, low, high);
+		if (std::find(forward.begin(), forward.end(), dependency) != forward.end()) return false;
+		std::vector<NodeId> backward = collect(dependency, &Record::dependencies, low, high);
+
+		// Both sets keep the positions they had, dependencies of the
+		// dependency going first.
+		auto byPosition = [this](NodeId a, NodeId b) { return m_records[a].position < m_records[b].position; };
+		std::sort(forward.begin(), forward.end(), byPosition);
+		std::sort(backward.begin(), backward.end(), byPosition);
+		std::vector<std::uint32_t> positions;
+		positions.reserve(forward.size() + backward.size());
+		for (NodeId id : backward) positions.push_back(m_records[id].position);
+		for (NodeId id : forward) positions.push_back(m_records[id].position);
+		std::sort(positions.begin(), positions.end());
+
+		std::size_t k = 0;
+		for (NodeId id : backward) m_order[m_records[id].position = positions[k++]] = id;
+		for (NodeId id : forward) m_order[m_records[id].position = positions[k++]] = id;
+	}
+
+	m_records[dependee].dependencies.push_back(dependency);
+	m_records[dependency].dependees.push_back(dependee);
+	m_adjacencyDirty = true;
+	return true;
+}
+
+template <typename Context>
+std::vector<typename DynamicDepsGraph<Context>::NodeId> DynamicDepsGraph<Context>::collect(NodeId start, std::vector<NodeId> Record::*next, std::uint32_t low, std::uint32_t high) {
+	m_visited.resize(m_records.size(), 0);
+	std::vector<NodeId> reached = { start };
+	m_visited[start] = 1;
+	for (std::size_t k = 0; k < reached.size(); ++k) {
+		for (NodeId other : m_records[reached[k]].*next) {
+			std::uint32_t position = m_records[other].position;
+			if (!m_visited[other] && low <= position && position <= high) {
+				m_visited[other] = 1;
+				reached.push_back(other);
+			}
+		}
+	}
+	for (NodeId id : reached) m_visited[id] = 0;
+	return reached;
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::removeNode(Context& ctx, NodeId node) {
+	destroy(ctx, node);
+	Record& record = m_records[node];
+	for (NodeId dependency : record.dependencies) {
+		auto& dependees = m_records[dependency].dependees;
+		dependees.erase(std::find(dependees.begin(), dependees.end(), node));
+	}
+	for (NodeId dependee : record.dependees) {
+		auto& dependencies = m_records[dependee].dependencies;
+		dependencies.erase(std::find(dependencies.begin(), dependencies.end(), node));
+	}
+	m_order.erase(m_order.begin() + record.position);
+	for (std::uint32_t position = record.position; position < m_order.size(); ++position) {
+		m_records[m_order[position]].position = position;
+	}
+	record = Record{};
+	m_freeIds.push_back(node);
+	m_adjacencyDirty = true;
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::updateAdjacency() {
+	if (!m_adjacencyDirty) return;
+	const std::size_t count = m_order.size();
+	m_dependencyOffsets.assign(count + 1, 0);
+	m_dependencies.clear();
+	for (std::size_t position = 0; position < count; ++position) {
+		for (NodeId dependency : m_records[m_order[position]].dependencies) {
+			m_dependencies.push_back(m_records[dependency].position);
+		}
+		m_dependencyOffsets[position + 1] = static_cast<std::uint32_t>(m_dependencies.size());
+	}
+	m_adjacencyDirty = false;
+}
+
+// Node operations
+
+template <typename Context>
+bool DynamicDepsGraph<Context>::existsAt(Context& ctx, std::uint32_t position) const {
+	const Record& record = m_records[m_order[position]];
+	if (record.callbacks.exists) return record.callbacks.exists(ctx, record.callbacks.user);
+	return record.ready;
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::createAt(Context& ctx, std::uint32_t position) {
+	Record& record = m_records[m_order[position]];
+	if (record.callbacks.create) record.callbacks.create(ctx, record.callbacks.user);
+	record.ready = true;
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::destroyAt(Context& ctx, std::uint32_t position) {
+	Record& record = m_records[m_order[position]];
+	if (record.callbacks.destroy) record.callbacks.destroy(ctx, record.callbacks.user);
+	record.ready = false;
+}
+
+template <typename Context>
+bool DynamicDepsGraph<Context>::exists(Context& ctx, NodeId node) const {
+	return existsAt(ctx, m_records[node].position);
+}
+
+// Graph operations
+
+template <typename Context>
+void DynamicDepsGraph<Context>::ensureExists(Context& ctx, NodeId node) {
+	updateAdjacency();
+	const std::uint32_t last = m_records[node].position;
+
+	// Dependencies are before their dependees, so the closure is known once
+	// all nodes after a node have been visited.
+	m_marks.assign(last + 1, 0);
+	m_marks[last] = 1;
+	for (std::uint32_t position = last + 1; position-- > 0;) {
+		if (!m_marks[position]) continue;
+		for (std::uint32_t e = m_dependencyOffsets[position]; e < m_dependencyOffsets[position + 1]; ++e) {
+			m_marks[m_dependencies[e]] = 1;
+		}
+	}
+	for (std::uint32_t position = 0; position <= last; ++position) {
+		if (m_marks[position] && !existsAt(ctx, position)) createAt(ctx, position);
+	}
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::rebuild(Context& ctx, NodeId node) {
+	updateAdjacency();
+	const std::uint32_t first = m_records[node].position;
+	const std::uint32_t count = static_cast<std::uint32_t>(m_order.size());
+
+	// Same as the static rebuild(), where affected nodes are the dependees
+	m_marks.assign(count, 0);
+	m_existed.assign(count, 0);
+	m_marks[first] = 1;
+	m_existed[first] = true;
+	for (std::uint32_t position = first + 1; position < count; ++position) {
+		for (std::uint32_t e = m_dependencyOffsets[position]; e < m_dependencyOffsets[position + 1]; ++e) {
+			if (m_marks[m_dependencies[e]]) {
+				m_marks[position] = 1;
+				m_existed[position] = existsAt(ctx, position);
+				break;
+			}
+		}
+	}
+	for (std::uint32_t position = count; position-- > first;) {
+		if (!m_marks[position]) continue;
+		if (position == first ? existsAt(ctx, position) : m_existed[position]) destroyAt(ctx, position);
+	}
+	for (std::uint32_t position = first; position < count; ++position) {
+		if (m_marks[position] && m_existed[position]) createAt(ctx, position);
+	}
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::destroy(Context& ctx, NodeId node) {
+	updateAdjacency();
+	const std::uint32_t first = m_records[node].position;
+	const std::uint32_t count = static_cast<std::uint32_t>(m_order.size());
+	m_marks.assign(count, 0);
+	m_marks[first] = 1;
+	for (std::uint32_t position = first + 1; position < count; ++position) {
+		for (std::uint32_t e = m_dependencyOffsets[position]; e < m_dependencyOffsets[position + 1]; ++e) {
+			if (m_marks[m_dependencies[e]]) {
+				m_marks[position] = 1;
+				break;
+			}
+		}
+	}
+	for (std::uint32_t position = count; position-- > first;) {
+		if (m_marks[position] && existsAt(ctx, position)) destroyAt(ctx, position);
+	}
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::createAll(Context& ctx) {
+	for (std::uint32_t position = 0; position < m_order.size(); ++position) {
+		if (!existsAt(ctx, position)) createAt(ctx, position);
+	}
+}
+
+template <typename Context>
+void DynamicDepsGraph<Context>::destroyAll(Context& ctx) {
+	for (std::uint32_t position = static_cast<std::uint32_t>(m_order.size()); position-- > 0;) {
+		if (existsAt(ctx, position)) destroyAt(ctx, position);
+	}
+}
+
+template <typename Context>
+bool DynamicDepsGraph<Context>::allExist(Context& ctx) const {
+	for (std::uint32_t position = 0; position < m_order.size(); ++position) {
+		if (!existsAt(ctx, position)) return false;
+	}
+	return true;
+}
+
+// DynamicSubgraphNode
+
+template <typename Context, DynamicDepsGraph<Context> Context::*graph>
+struct DynamicSubgraphNode : DepsNodeBuilder::with_context<Context>::build {
+	static constexpr bool UseCreate() { return true; }
+	static void Create(Context& ctx) { (ctx.*graph).createAll(ctx); }
+	static void Destroy(Context& ctx) { (ctx.*graph).destroyAll(ctx); }
+	static constexpr bool UseExists() { return true; }
+	static bool Exists(Context& ctx) { return (ctx.*graph).allExist(ctx); }
+};
+
+#pragma endregion
+
+} // namespace statdeps
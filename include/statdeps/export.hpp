@@ -0,0 +1,300 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "algorithms.hpp"
+#include "nodename.hpp"
+#include "instrumentation.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <iostream>
+#include <utility>
+#include <string_view>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * Cost of creating each node of a graph, indexed like the graph tables, in
+ * whatever unit is convenient (measuredCosts() gives milliseconds).
+ */
+template <typename Graph>
+using NodeCosts = std::array<double, Graph::Tables::NodeCount>;
+
+/**
+ * The longest chain of dependencies of a graph, weighted by the cost of its
+ * nodes. Creating all nodes takes at least the cost of this chain however
+ * many threads are used, versus the total cost when creating them one after
+ * the other, so the ratio of both bounds the gain of a parallel executor.
+ */
+template <std::size_t NodeCount>
+struct CriticalPath {
+	// Indices of the nodes of the chain, such that each one depends on the
+	// previous one
+	std::array<std::size_t, NodeCount> nodes{};
+	std::size_t length = 0;
+	double cost = 0.0;
+	double totalCost = 0.0;
+
+	constexpr bool contains(std::size_t node) const noexcept;
+};
+
+/**
+ * Costs that count each node as 1, so that the critical path is the longest
+ * chain of dependencies.
+ */
+template <typename Graph>
+constexpr NodeCosts<Graph> unitCosts(Graph) noexcept;
+
+/**
+ * Average time spent in the create callback of each node, in milliseconds,
+ * as recorded by CountingInstrumentation (see with_instrumentation). Nodes
+ * that have not been created, or are not instrumented, cost 0.
+ */
+template <typename Graph>
+NodeCosts<Graph> measuredCosts(Graph);
+
+/**
+ * Compute the critical path of a graph, at compile time when the costs are
+ * known at this point.
+ */
+template <typename Graph>
+constexpr CriticalPath<Graph::Tables::NodeCount> criticalPath(Graph, const NodeCosts<Graph>& costs = unitCosts(Graph{})) noexcept;
+
+/**
+ * Write the graph in the DOT format of Graphviz, with an arrow from each node
+ * to each of its dependencies (like DepsEdge<A, B> reads "A depends on B").
+ * Nodes are named after nodeName() and the critical path is highlighted.
+ * When costs are given, they annotate nodes and the critical path is
+ * weighted by them, otherwise it is the longest chain of dependencies.
+ */
+template <typename Graph>
+void exportDot(std::ostream& out, Graph);
+
+template <typename Graph>
+void exportDot(std::ostream& out, Graph, const NodeCosts<Graph>& costs);
+
+/**
+ * Write the graph as a JSON object with the same information as exportDot():
+ *
+ *     {
+ *       "nodes": [{ "index": 0, "name": "...", "level": 0, "cost": 1, "critical": true }, ...],
+ *       "edges": [{ "dependee": 1, "dependency": 0 }, ...],
+ *       "criticalPath": [0, 1, ...],
+ *       "criticalPathCost": 2,
+ *       "totalCost": 3
+ *     }
+ *
+ * The "cost" of nodes is only written when costs are given.
+ */
+template <typename Graph>
+void exportJson(std::ostream& out, Graph);
+
+template <typename Graph>
+void exportJson(std::ostream& out, Graph, const NodeCosts<Graph>& costs);
+
+/**
+ * Mostly for debug: list the dependencies of a node by name (see nodeName),
+ * to the standard output or to a given stream.
+ */
+template <typename Node, typename Graph>
+void printDependencies(Node, Graph);
+
+template <typename Node, typename Graph>
+void printDependencies(std::ostream& out, Node, Graph);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+template <std::size_t NodeCount>
+constexpr bool CriticalPath<NodeCount>::contains(std::size_t node) const noexcept {
+	for (std::size_t k = 0; k < length; ++k) {
+		if (nodes[k] == node) return true;
+	}
+	return false;
+}
+
+template <typename Graph>
+constexpr NodeCosts<Graph> unitCosts(Graph) noexcept {
+	NodeCosts<Graph> costs{};
+	for (double& cost : costs) cost = 1.0;
+	return costs;
+}
+
+namespace detail {
+
+template <typename Graph, std::size_t... Is>
+NodeCosts<Graph> measuredCosts(std::index_sequence<Is...>) {
+	auto averageMilliseconds = [](const NodeCounters& counters) {
+		const std::uint64_t creations = counters.creations;
+		return creations == 0 ? 0.0 : static_cast<double>(counters.creationNanoseconds) / creations * 1e-6;
+	};
+	using Tables = typename Graph::Tables;
+	return { averageMilliseconds(CountingInstrumentation::counters<typename Tables::template NodeAt<Is>>())... };
+}
+
+template <typename Tables, std::size_t... Is>
+constexpr std::array<std::string_view, sizeof...(Is)> nodeNames(std::index_sequence<Is...>) noexcept {
+	return { nodeName(typename Tables::template NodeAt<Is>{})... };
+}
+
+template <typename Tables>
+inline constexpr auto nodeNamesOf = nodeNames<Tables>(std::make_index_sequence<Tables::NodeCount>{});
+
+// Write a string escaped the same way for DOT and JSON, without its quotes
+inline void writeEscaped(std::ostream& out, std::string_view text) {
+	for (char c : text) {
+		if (c == '"' || c == '\\') out << '\\';
+		out << c;
+	}
+}
+
+template <typename Graph>
+void writeDot(std::ostream& out, const NodeCosts<Graph>& costs, bool annotated) {
+	using Tables = typename Graph::Tables;
+	constexpr auto& names = nodeNamesOf<Tables>;
+	const CriticalPath<Tables::NodeCount> path = criticalPath(Graph{}, costs);
+
+	out << "digraph DepsGraph {\n";
+	if (annotated) {
+		out << "\tlabel=\"critical path: " << path.cost << ", total: " << path.totalCost << "\";\n";
+	}
+	out << "\tnode [shape=box];\n";
+	for (std::size_t i = 0; i < Tables::NodeCount; ++i) {
+		out << "\tn" << i << " [label=\"";
+		writeEscaped(out, names[i]);
+		if (annotated) out << "\\n" << costs[i];
+		out << '"';
+		if (path.contains(i)) out << ", color=red, penwidth=2";
+		out << "];\n";
+	}
+	for (std::size_t i = 0; i < Tables::NodeCount; ++i) {
+		for (std::size_t e = Tables::dependencyOffsets[i]; e < Tables::dependencyOffsets[i + 1]; ++e) {
+			const std::size_t j = Tables::dependencies[e];
+			out << "\tn" << i << " -> n" << j;
+			// The path goes from dependencies to dependees
+			bool critical = false;
+			for (std::size_t k = 0; k + 1 < path.length; ++k) {
+				if (path.nodes[k] == j && path.nodes[k + 1] == i) critical = true;
+			}
+			if (critical) out << " [color=red, penwidth=2]";
+			out << ";\n";
+		}
+	}
+	out << "}\n";
+}
+
+template <typename Graph>
+void writeJson(std::ostream& out, const NodeCosts<Graph>& costs, bool annotated) {
+	using Tables = typename Graph::Tables;
+	constexpr auto& names = nodeNamesOf<Tables>;
+	const CriticalPath<Tables::NodeCount> path = criticalPath(Graph{}, costs);
+
+	out << "{\n\t\"nodes\": [";
+	for (std::size_t i = 0; i < Tables::NodeCount; ++i) {
+		out << (i == 0 ? "\n" : ",\n") << "\t\t{ \"index\": " << i << ", \"name\": \"";
+		writeEscaped(out, names[i]);
+		out << "\", \"level\": " << Tables::levels[i];
+		if (annotated) out << ", \"cost\": " << costs[i];
+		out << ", \"critical\": " << (path.contains(i) ? "true" : "false") << " }";
+	}
+	out << "\n\t],\n\t\"edges\": [";
+	bool first = true;
+	for (std::size_t i = 0; i < Tables::NodeCount; ++i) {
+		for (std::size_t e = Tables::dependencyOffsets[i]; e < Tables::dependencyOffsets[i + 1]; ++e) {
+			out << (first ? "\n" : ",\n") << "\t\t{ \"dependee\": " << i << ", \"dependency\": " << Tables::dependencies[e] << " }";
+			first = false;
+		}
+	}
+	out << "\n\t],\n\t\"criticalPath\": [";
+	for (std::size_t k = 0; k < path.length; ++k) {
+		out << (k == 0 ? "" : ", ") << path.nodes[k];
+	}
+	out << "],\n\t\"criticalPathCost\": " << path.cost;
+	out << ",\n\t\"totalCost\": " << path.totalCost << "\n}\n";
+}
+
+} // namespace detail
+
+template <typename Graph>
+NodeCosts<Graph> measuredCosts(Graph) {
+	using Tables = typename Graph::Tables;
+	return detail::measuredCosts<Graph>(std::make_index_sequence<Tables::NodeCount>{});
+}
+
+template <typename Graph>
+constexpr CriticalPath<Graph::Tables::NodeCount> criticalPath(Graph, const NodeCosts<Graph>& costs) noexcept {
+	using Tables = typename Graph::Tables;
+	constexpr std::size_t NodeCount = Tables::NodeCount;
+
+	// Cost of the most expensive chain that ends at each node, and the
+	// dependency that precedes it in this chain
+	std::array<double, NodeCount> finish{};
+	std::array<std::size_t, NodeCount> previous{};
+	CriticalPath<NodeCount> path;
+	std::size_t last = NodeCount;
+	for (std::size_t k = 0; k < NodeCount; ++k) {
+		const std::size_t i = Tables::topologicalOrder[k];
+		previous[i] = NodeCount;
+		for (std::size_t e = Tables::dependencyOffsets[i]; e < Tables::dependencyOffsets[i + 1]; ++e) {
+			const std::size_t d = Tables::dependencies[e];
+			if (previous[i] == NodeCount || finish[d] > finish[previous[i]]) previous[i] = d;
+		}
+		finish[i] = costs[i] + (previous[i] == NodeCount ? 0.0 : finish[previous[i]]);
+		path.totalCost += costs[i];
+		if (last == NodeCount || finish[i] > finish[last]) last = i;
+	}
+
+	if (last == NodeCount) return path;
+	path.cost = finish[last];
+	for (std::size_t i = last; i != NodeCount; i = previous[i]) {
+		path.nodes[path.length++] = i;
+	}
+	for (std::size_t k = 0; k < path.length / 2; ++k) {
+		const std::size_t tmp = path.nodes[k];
+		path.nodes[k] = path.nodes[path.length - 1 - k];
+		path.nodes[path.length - 1 - k] = tmp;
+	}
+	return path;
+}
+
+template <typename Graph>
+void exportDot(std::ostream& out, Graph) {
+	detail::writeDot<Graph>(out, unitCosts(Graph{}), false);
+}
+
+template <typename Graph>
+void exportDot(std::ostream& out, Graph, const NodeCosts<Graph>& costs) {
+	detail::writeDot<Graph>(out, costs, true);
+}
+
+template <typename Graph>
+void exportJson(std::ostream& out, Graph) {
+	detail::writeJson<Graph>(out, unitCosts(Graph{}), false);
+}
+
+template <typename Graph>
+void exportJson(std::ostream& out, Graph, const NodeCosts<Graph>& costs) {
+	detail::writeJson<Graph>(out, costs, true);
+}
+
+template <typename Node, typename Graph>
+void printDependencies(Node, Graph) {
+	printDependencies(std::cout, Node{}, Graph{});
+}
+
+template <typename Node, typename Graph>
+void printDependencies(std::ostream& out, Node, Graph) {
+	forEach(allDependencies(Node{}, Graph{}), [&out](auto dependency) { out << nodeName(dependency) << '\n'; });
+}
+
+#pragma endregion
+
+} // namespace statdeps
@@ -0,0 +1,553 @@
+#pragma once
+
+#include "depsgraph.hpp"
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * The flattened representation of a DepsGraph, computed at compile time and
+ * accessible as DepsGraph<...>::Tables.
+ *
+ * Each node is given a contiguous index: nodes of the node list first, then
+ * nodes inferred from the edge list, in order of appearance. Edges are stored
+ * as CSR-style adjacency tables, namely the direct dependencies of node i are
+ * the indices
+ *
+ *   dependencies[dependencyOffsets[i]] ... dependencies[dependencyOffsets[i + 1] - 1]
+ *
+ * and similarly for dependees. The topological order lists nodes such that
+ * each one comes after all of its dependencies.
+ *
+ * Graph algorithms only read these tables, so that the number of template
+ * instantiations they require remains linear in the size of the graph rather
+ * than rescanning the edge list for each visited node.
+ */
+template <typename Graph>
+struct GraphTables;
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, utility functions (private)]
+
+namespace detail {
+
+// Each type gets a unique address, which can be compared in constant
+// expressions without instantiating a std::is_same for each pair of types.
+template <typename T>
+struct TypeTag {
+	static constexpr char id = 0;
+};
+
+template <typename T>
+constexpr const void* typeId = &TypeTag<T>::id;
+
+// Random access to the I-th type of a pack, without recursive instantiations.
+template <std::size_t I, typename T>
+struct IndexedType {
+	using Type = T;
+};
+
+template <typename Sequence, typename... Ts>
+struct IndexedTypes;
+
+template <std::size_t... Is, typename... Ts>
+struct IndexedTypes<std::index_sequence<Is...>, Ts...> : IndexedType<Is, Ts>... {};
+
+template <std::size_t I, typename T>
+IndexedType<I, T> selectIndexed(const IndexedType<I, T>&) noexcept;
+
+template <std::size_t I, typename... Ts>
+using TypeAt = typename decltype(selectIndexed<I>(std::declval<const IndexedTypes<std::index_sequence_for<Ts...>, Ts...>&>()))::Type;
+
+// Return the first index i < end such that ids[i] == id, or end if not found.
+template <std::size_t Count>
+constexpr std::size_t findId(const std::array<const void*, Count>& ids, const void* id, std::size_t end = Count) noexcept {
+	// Raw pointer access is much cheaper than operator[] in constant evaluation
+	const void* const* data = ids.data();
+	for (std::size_t i = 0; i < end; ++i) {
+		if (data[i] == id) return i;
+	}
+	return end;
+}
+
+// Map each id to the rank of its first occurrence among distinct ids, i.e.,
+// to a contiguous node index.
+template <std::size_t Count>
+constexpr std::array<std::size_t, Count> denseIndices(const std::array<const void*, Count>& ids) noexcept {
+	std::array<std::size_t, Count> indices{};
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < Count; ++i) {
+		std::size_t first = findId(ids, ids[i], i);
+		indices[i] = first == i ? count++ : indices[first];
+	}
+	return indices;
+}
+
+template <std::size_t Count>
+constexpr std::size_t countDistinct(const std::array<std::size_t, Count>& indices) noexcept {
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < Count; ++i) {
+		if (indices[i] == count) ++count;
+	}
+	return count;
+}
+
+// Position of the first occurrence of each index
+template <std::size_t DistinctCount, std::size_t Count>
+constexpr std::array<std::size_t, DistinctCount> firstOccurrences(const std::array<std::size_t, Count>& indices) noexcept {
+	std::array<std::size_t, DistinctCount> positions{};
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < Count; ++i) {
+		if (indices[i] == count) positions[count++] = i;
+	}
+	return positions;
+}
+
+// Sub-range [Offset, Offset + Size) of an array
+template <std::size_t Offset, std::size_t Size, typename T, std::size_t Count>
+constexpr std::array<T, Size> slice(const std::array<T, Count>& array) noexcept {
+	std::array<T, Size> sub{};
+	for (std::size_t i = 0; i < Size; ++i) {
+		sub[i] = array[Offset + i];
+	}
+	return sub;
+}
+
+// Build the offsets of a CSR table, where sources[e] is the row of edge e.
+template <std::size_t NodeCount, std::size_t EdgeCount>
+constexpr std::array<std::size_t, NodeCount + 1> csrOffsets(const std::array<std::size_t, EdgeCount>& sources) noexcept {
+	std::array<std::size_t, NodeCount + 1> offsets{};
+	for (std::size_t e = 0; e < EdgeCount; ++e) {
+		++offsets[sources[e] + 1];
+	}
+	for (std::size_t i = 0; i < NodeCount; ++i) {
+		offsets[i + 1] += offsets[i];
+	}
+	return offsets;
+}
+
+// Fill the columns of a CSR table, keeping edges in declaration order.
+template <std::size_t NodeCount, std::size_t EdgeCount>
+constexpr std::array<std::size_t, EdgeCount> csrTargets(
+	const std::array<std::size_t, EdgeCount>& sources,
+	const std::array<std::size_t, EdgeCount>& targets,
+	const std::array<std::size_t, NodeCount + 1>& offsets
+) noexcept {
+	std::array<std::size_t, EdgeCount> columns{};
+	std::array<std::size_t, NodeCount + 1> cursor = offsets;
+	for (std::size_t e = 0; e < EdgeCount; ++e) {
+		columns[cursor[sources[e]]++] = targets[e];
+	}
+	return columns;
+}
+
+// Kahn's algorithm. If the graph has cycles, nodes that are part of or depend
+// on a cycle are missing, and the remaining entries are set to NodeCount.
+template <std::size_t NodeCount, std::size_t EdgeCount>
+constexpr std::array<std::size_t, NodeCount> topologicalOrder(
+	const std::array<std::size_t, NodeCount + 1>& dependencyOffsets,
+	const std::array<std::size_t, NodeCount + 1>& dependeeOffsets,
+	const std::array<std::size_t, EdgeCount>& dependees
+) noexcept {
+	std::array<std::size_t, NodeCount> order{};
+	std::array<std::size_t, NodeCount> remaining{};
+	std::size_t end = 0;
+	for (std::size_t i = 0; i < NodeCount; ++i) {
+		remaining[i] = dependencyOffsets[i + 1] - dependencyOffsets[i];
+		if (remaining[i] == 0) order[end++] = i;
+	}
+	for (std::size_t k = 0; k < end; ++k) {
+		std::size_t i = order[k];
+		for (std::size_t e = dependeeOffsets[i]; e < dependeeOffsets[i + 1]; ++e) {
+			if (--remaining[dependees[e]] == 0) order[end++] = dependees[e];
+		}
+	}
+	for (std::size_t k = end; k < NodeCount; ++k) {
+		order[k] = NodeCount;
+	}
+	return order;
+}
+
+// Length of the longest chain of dependencies leading to each node
+template <std::size_t NodeCount, std::size_t EdgeCount>
+constexpr std::array<std::size_t, NodeCount> levels(
+	const std::array<std::size_t, NodeCount>& order,
+	const std::array<std::size_t, NodeCount + 1>& dependencyOffsets,
+	const std::array<std::size_t, EdgeCount>& dependencies
+) noexcept {
+	std::array<std::size_t, NodeCount> level{};
+	for (std::size_t k = 0; k < NodeCount && order[k] < NodeCount; ++k) {
+		std::size_t i = order[k];
+		for (std::size_t e = dependencyOffsets[i]; e < dependencyOffsets[i + 1]; ++e) {
+			std::size_t candidate = level[dependencies[e]] + 1;
+			if (candidate > level[i]) level[i] = candidate;
+		}
+	}
+	return level;
+}
+
+template <std::size_t NodeCount>
+constexpr std::size_t countSorted(const std::array<std::size_t, NodeCount>& order) noexcept {
+	std::size_t count = 0;
+	while (count < NodeCount && order[count] != NodeCount) ++count;
+	return count;
+}
+
+// A cycle of dependencies, as the indices of its nodes such that each one
+// depends on the next one and the last one on the first one, or an empty
+// cycle if the topological order contains all nodes.
+template <std::size_t NodeCount>
+struct Cycle {
+	std::array<std::size_t, NodeCount> nodes{};
+	std::size_t length = 0;
+};
+
+template <std::size_t NodeCount, std::size_t EdgeCount>
+constexpr Cycle<NodeCount> findCycle(
+	const std::array<std::size_t, NodeCount>& order,
+	std::size_t sortedCount,
+	const std::array<std::size_t, NodeCount + 1>& dependencyOffsets,
+	const std::array<std::size_t, EdgeCount>& dependencies
+) noexcept {
+	Cycle<NodeCount> cycle;
+	if (sortedCount == NodeCount) return cycle;
+
+	// Each node that Kahn's algorithm could not sort has a dependency that
+	// could not be sorted either, so following them eventually loops.
+	std::array<bool, NodeCount> sorted{};
+	for (std::size_t k = 0; k < sortedCount; ++k) sorted[order[k]] = true;
+	std::array<std::size_t, NodeCount> visitedAt{};
+	for (std::size_t i = 0; i < NodeCount; ++i) visitedAt[i] = NodeCount;
+	std::array<std::size_t, NodeCount> path{};
+	std::size_t i = 0;
+	while (sorted[i]) ++i;
+	for (std::size_t length = 0; visitedAt[i] == NodeCount; ++length) {
+		visitedAt[i] = length;
+		path[length] = i;
+		std::size_t e = dependencyOffsets[i];
+		while (sorted[dependencies[e]]) ++e;
+		i = dependencies[e];
+		cycle.length = length + 1;
+	}
+	std::size_t first = visitedAt[i];
+	for (std::size_t k = first; k < cycle.length; ++k) cycle.nodes[k - first] = path[k];
+	cycle.length -= first;
+	return cycle;
+}
+
+// Fails to compile when Cycle is a non-empty List of nodes, which compilers
+// print when reporting the error.
+template <typename Cycle>
+struct AssertAcyclic {
+	static_assert(std::is_same_v<Cycle, List<>>, "The dependency graph contains a cycle, see the nodes of AssertAcyclic<List<...>>: each one depends on the next one, and the last one on the first one");
+	static constexpr bool value = true;
+};
+
+// Nodes reachable from root when following the given adjacency table. The
+// root itself is not included (unless it is part of a cycle).
+template <std::size_t NodeCount, std::size_t EdgeCount>
+constexpr std::array<bool, NodeCount> reachable(
+	std::size_t root,
+	const std::array<std::size_t, NodeCount + 1>& offsets,
+	const std::array<std::size_t, EdgeCount>& targets
+) noexcept {
+	std::array<bool, NodeCount> mask{};
+	if (root >= NodeCount) return mask;
+	std::array<std::size_t, NodeCount + 1> stack{};
+	std::size_t top = 0;
+	stack[top++] = root;
+	while (top > 0) {
+		std::size_t i = stack[--top];
+		for (std::size_t e = offsets[i]; e < offsets[i + 1]; ++e) {
+			std::size_t j = targets[e];
+			if (!mask[j]) {
+				mask[j] = true;
+				stack[top++] = j;
+			}
+		}
+	}
+	return mask;
+}
+
+// Union of the given roots and of the nodes reachable from each of them.
+// Roots that are out of range are ignored.
+template <std::size_t NodeCount, std::size_t EdgeCount, std::size_t RootCount>
+constexpr std::array<bool, NodeCount> reachableFrom(
+	const std::array<std::size_t, RootCount>& roots,
+	const std::array<std::size_t, NodeCount + 1>& offsets,
+	const std::array<std::size_t, EdgeCount>& targets
+) noexcept {
+	std::array<bool, NodeCount> mask{};
+	for (std::size_t r = 0; r < RootCount; ++r) {
+		if (roots[r] >= NodeCount) continue;
+		mask[roots[r]] = true;
+		std::array<bool, NodeCount> reached = reachable<NodeCount>(roots[r], offsets, targets);
+		for (std::size_t i = 0; i < NodeCount; ++i) mask[i] = mask[i] || reached[i];
+	}
+	return mask;
+}
+
+template <std::size_t NodeCount>
+constexpr std::size_t countMask(const std::array<bool, NodeCount>& mask) noexcept {
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < NodeCount; ++i) {
+		if (mask[i]) ++count;
+	}
+	return count;
+}
+
+// Filter the topological order to only keep the nodes of the mask
+template <std::size_t Count, std::size_t NodeCount>
+constexpr std::array<std::size_t, Count> sortedSubset(
+	const std::array<std::size_t, NodeCount>& order,
+	const std::array<bool, NodeCount>& mask
+) noexcept {
+	std::array<std::size_t, Count> subset{};
+	std::size_t j = 0;
+	for (std::size_t k = 0; k < NodeCount && j < Count; ++k) {
+		if (order[k] < NodeCount && mask[order[k]]) subset[j++] = order[k];
+	}
+	return subset;
+}
+
+} // namespace detail
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, graph tables (private)]
+
+template <typename... Ns, typename... Es>
+struct GraphTables<DepsGraph<List<Ns...>, List<Es...>>> {
+private:
+	// All occurrences of nodes in the graph definition, with duplicates
+	static constexpr std::size_t OccurrenceCount = sizeof...(Ns) + 2 * sizeof...(Es);
+
+	static constexpr std::array<const void*, OccurrenceCount> occurrenceIds = {
+		detail::typeId<Ns>...,
+		detail::typeId<typename Es::Dependee>...,
+		detail::typeId<typename Es::Dependency>...
+	};
+
+	// Node index of each occurrence
+	static constexpr std::array<std::size_t, OccurrenceCount> occurrenceIndices = detail::denseIndices(occurrenceIds);
+
+	template <std::size_t I>
+	using OccurrenceAt = detail::TypeAt<I, Ns..., typename Es::Dependee..., typename Es::Dependency...>;
+
+public:
+	static constexpr std::size_t NodeCount = detail::countDistinct(occurrenceIndices);
+
+	static constexpr std::size_t EdgeCount = sizeof...(Es);
+
+private:
+	static constexpr std::array<std::size_t, NodeCount> nodeOccurrences = detail::firstOccurrences<NodeCount>(occurrenceIndices);
+
+public:
+	/**
+	 * Type identifiers of the nodes, in index order
+	 */
+	static constexpr std::array<const void*, NodeCount> nodeIds = [] {
+		std::array<const void*, NodeCount> ids{};
+		for (std::size_t i = 0; i < NodeCount; ++i) ids[i] = occurrenceIds[nodeOccurrences[i]];
+		return ids;
+	}();
+
+	/**
+	 * Index of a node type in the tables, or NodeCount if the node does not
+	 * belong to the graph.
+	 */
+	template <typename Node>
+	static constexpr std::size_t IndexOf = detail::findId(nodeIds, detail::typeId<Node>);
+
+	/**
+	 * Node type corresponding to a given index
+	 */
+	template <std::size_t I>
+	using NodeAt = OccurrenceAt<nodeOccurrences[I]>;
+
+	/**
+	 * Endpoints of each edge, in declaration order
+	 */
+	static constexpr std::array<std::size_t, EdgeCount> edgeDependees = detail::slice<sizeof...(Ns), EdgeCount>(occurrenceIndices);
+	static constexpr std::array<std::size_t, EdgeCount> edgeDependencies = detail::slice<sizeof...(Ns) + EdgeCount, EdgeCount>(occurrenceIndices);
+
+	/**
+	 * CSR adjacency tables
+	 */
+	static constexpr std::array<std::size_t, NodeCount + 1> dependencyOffsets = detail::csrOffsets<NodeCount>(edgeDependees);
+	static constexpr std::array<std::size_t, EdgeCount> dependencies = detail::csrTargets<NodeCount>(edgeDependees, edgeDependencies, dependencyOffsets);
+	static constexpr std::array<std::size_t, NodeCount + 1> dependeeOffsets = detail::csrOffsets<NodeCount>(edgeDependencies);
+	static constexpr std::array<std::size_t, EdgeCount> dependees = detail::csrTargets<NodeCount>(edgeDependencies, edgeDependees, dependeeOffsets);
+
+	/**
+	 * Minimum level of the dependency required by each edge (see with_levels),
+	 * in declaration order and aligned with the dependencies table
+	 */
+	static constexpr std::array<std::size_t, EdgeCount> edgeLevels = { Es::Level... };
+	static constexpr std::array<std::size_t, EdgeCount> dependencyLevels = detail::csrTargets<NodeCount>(edgeDependees, edgeLevels, dependencyOffsets);
+
+	/**
+	 * All nodes, sorted such that each node comes after its dependencies.
+	 * Graphs that contain cycles are rejected at compile time, so SortedCount
+	 * is always NodeCount.
+	 */
+	static constexpr std::array<std::size_t, NodeCount> topologicalOrder = detail::topologicalOrder<NodeCount>(dependencyOffsets, dependeeOffsets, dependees);
+	static constexpr std::size_t SortedCount = detail::countSorted(topologicalOrder);
+
+private:
+	static constexpr detail::Cycle<NodeCount> cycle = detail::findCycle<NodeCount>(topologicalOrder, SortedCount, dependencyOffsets, dependencies);
+
+	template <std::size_t... Ks>
+	static auto cycleList(std::index_sequence<Ks...>) -> List<NodeAt<cycle.nodes[Ks]>...>;
+
+	static_assert(detail::AssertAcyclic<decltype(cycleList(std::make_index_sequence<cycle.length>{}))>::value);
+
+public:
+
+	/**
+	 * The level of a node is the length of the longest chain of dependencies
+	 * that leads to it, so nodes of a same level never depend on each other.
+	 */
+	static constexpr std::array<std::size_t, NodeCount> levels = detail::levels<NodeCount>(topologicalOrder, dependencyOffsets, dependencies);
+
+	/**
+	 * Indices of all the direct and indirect dependencies (resp. dependees) of
+	 * the node at index I, sorted in topological order.
+	 */
+	template <std::size_t I>
+	static constexpr auto dependencyClosure = [] {
+		constexpr auto mask = detail::reachable<NodeCount>(I, dependencyOffsets, dependencies);
+		return detail::sortedSubset<detail::countMask(mask)>(topologicalOrder, mask);
+	}();
+
+	template <std::size_t I>
+	static constexpr auto dependeeClosure = [] {
+		constexpr auto mask = detail::reachable<NodeCount>(I, dependeeOffsets, dependees);
+		return detail::sortedSubset<detail::countMask(mask)>(topologicalOrder, mask);
+	}();
+
+	/**
+	 * Indices of the nodes at indices Is and of all of their dependees, sorted
+	 * in topological order. Indices that are out of range are ignored.
+	 */
+	template <std::size_t... Is>
+	static constexpr auto dependeeUnion = [] {
+		constexpr auto mask = detail::reachableFrom<NodeCount>(std::array<std::size_t, sizeof...(Is)>{ Is... }, dependeeOffsets, dependees);
+		return detail::sortedSubset<detail::countMask(mask)>(topologicalOrder, mask);
+	}();
+
+private:
+	template <std::size_t I, std::size_t... Ks>
+	static auto dependencyList(std::index_sequence<Ks...>) -> List<NodeAt<dependencyClosure<I>[Ks]>...>;
+
+	template <std::size_t I, std::size_t... Ks>
+	static auto dependeeList(std::index_sequence<Ks...>) -> List<NodeAt<dependeeClosure<I>[Ks]>...>;
+
+	template <typename Indices, std::size_t... Ks>
+	static auto unionList(Indices, std::index_sequence<Ks...>) -> List<NodeAt<Indices::value[Ks]>...>;
+
+	template <std::size_t... Is>
+	struct UnionIndices {
+		static constexpr const auto& value = dependeeUnion<Is...>;
+	};
+
+public:
+	/**
+	 * The closures as lists of node types, see allDependencies() and allDependees()
+	 */
+	template <typename Node>
+	using DependenciesOf = decltype(dependencyList<IndexOf<Node>>(std::make_index_sequence<dependencyClosure<IndexOf<Node>>.size()>{}));
+
+	template <typename Node>
+	using DependeesOf = decltype(dependeeList<IndexOf<Node>>(std::make_index_sequence<dependeeClosure<IndexOf<Node>>.size()>{}));
+
+	/**
+	 * The given nodes that belong to the graph and all of their dependees, as
+	 * a list of node types sorted in topological order
+	 */
+	template <typename... Nodes>
+	using DependeeUnionOf = decltype(unionList(UnionIndices<IndexOf<Nodes>...>{}, std::make_index_sequence<dependeeUnion<IndexOf<Nodes>...>.size()>{}));
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, subgraph plans (private)]
+
+// Node subsets used by the algorithms that schedule nodes at runtime,
+// e.g. parallel (see parallel.hpp) or asynchronous (see async.hpp) ones.
+
+namespace detail {
+
+/**
+ * A subset of the nodes of a graph, with the number of direct dependencies
+ * and dependees of each node within the subset. Nodes are referred to by
+ * their local index k, which points into the nodes array.
+ */
+template <std::size_t Count, std::size_t NodeCount>
+struct SubgraphPlan {
+	std::array<std::size_t, Count> nodes{}; // graph index of each node, in topological order
+	std::array<std::size_t, NodeCount> local{}; // local index of each graph node, or Count
+	std::array<std::size_t, Count> dependencyCounts{};
+	std::array<std::size_t, Count> dependeeCounts{};
+};
+
+template <typename Tables, std::size_t Count>
+constexpr auto makePlan(const std::array<std::size_t, Count>& nodes) noexcept {
+	SubgraphPlan<Count, Tables::NodeCount> plan;
+	plan.nodes = nodes;
+	for (std::size_t i = 0; i < Tables::NodeCount; ++i) plan.local[i] = Count;
+	for (std::size_t k = 0; k < Count; ++k) plan.local[nodes[k]] = k;
+	for (std::size_t k = 0; k < Count; ++k) {
+		std::size_t i = nodes[k];
+		for (std::size_t e = Tables::dependencyOffsets[i]; e < Tables::dependencyOffsets[i + 1]; ++e) {
+			if (plan.local[Tables::dependencies[e]] < Count) ++plan.dependencyCounts[k];
+		}
+		for (std::size_t e = Tables::dependeeOffsets[i]; e < Tables::dependeeOffsets[i + 1]; ++e) {
+			if (plan.local[Tables::dependees[e]] < Count) ++plan.dependeeCounts[k];
+		}
+	}
+	return plan;
+}
+
+// Subgraph made of the dependency closure of node I, then I itself
+template <typename Tables, std::size_t I>
+constexpr auto makeEnsurePlan() noexcept {
+	constexpr auto& closure = Tables::template dependencyClosure<I>;
+	std::array<std::size_t, closure.size() + 1> nodes{};
+	for (std::size_t k = 0; k < closure.size(); ++k) nodes[k] = closure[k];
+	nodes[closure.size()] = I;
+	return makePlan<Tables>(nodes);
+}
+
+// Subgraph made of node I, then its dependee closure
+template <typename Tables, std::size_t I>
+constexpr auto makeRebuildPlan() noexcept {
+	constexpr auto& closure = Tables::template dependeeClosure<I>;
+	std::array<std::size_t, closure.size() + 1> nodes{};
+	nodes[0] = I;
+	for (std::size_t k = 0; k < closure.size(); ++k) nodes[k + 1] = closure[k];
+	return makePlan<Tables>(nodes);
+}
+
+template <typename Tables, std::size_t I>
+inline constexpr auto ensurePlan = makeEnsurePlan<Tables, I>();
+
+template <typename Tables, std::size_t I>
+inline constexpr auto rebuildPlan = makeRebuildPlan<Tables, I>();
+
+} // namespace detail
+
+#pragma endregion
+
+} // namespace statdeps
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "boundnode.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * Operations on a node that an instrumentation policy (see
+ * with_instrumentation) is notified about. Existence checks are only
+ * reported for nodes that have an exists callback rather than a ready state.
+ */
+enum class NodeEvent {
+	Create,
+	Destroy,
+	Update,
+	Exists,
+	Refine, // see with_levels
+};
+
+/**
+ * Clock of the timestamps given to instrumentation policies
+ */
+using InstrumentationClock = std::chrono::steady_clock;
+
+/**
+ * Number of operations on a node and time spent in its callbacks, recorded
+ * by CountingInstrumentation.
+ */
+struct NodeCounters {
+	std::atomic<std::uint64_t> creations{ 0 };
+	std::atomic<std::uint64_t> destructions{ 0 };
+	std::atomic<std::uint64_t> updates{ 0 };
+	std::atomic<std::uint64_t> existenceChecks{ 0 };
+	std::atomic<std::uint64_t> refinements{ 0 };
+	std::atomic<std::uint64_t> nanoseconds{ 0 }; // spent creating, destroying, updating and refining
+	std::atomic<std::uint64_t> creationNanoseconds{ 0 }; // spent creating only
+};
+
+/**
+ * An instrumentation policy that counts operations per node, e.g., to find
+ * out which node is rebuilt at each frame.
+ */
+class CountingInstrumentation {
+public:
+	template <typename Node>
+	static NodeCounters& counters();
+
+	template <typename Node>
+	static void onBegin(NodeEvent, InstrumentationClock::time_point) {}
+
+	template <typename Node>
+	static void onEnd(NodeEvent event, InstrumentationClock::time_point begin, InstrumentationClock::time_point end);
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+template <typename Node>
+NodeCounters& CountingInstrumentation::counters() {
+	static NodeCounters nodeCounters;
+	return nodeCounters;
+}
+
+template <typename Node>
+void CountingInstrumentation::onEnd(NodeEvent event, InstrumentationClock::time_point begin, InstrumentationClock::time_point end) {
+	NodeCounters& nodeCounters = counters<Node>();
+	switch (event) {
+	case NodeEvent::Create: ++nodeCounters.creations; break;
+	case NodeEvent::Destroy: ++nodeCounters.destructions; break;
+	case NodeEvent::Update: ++nodeCounters.updates; break;
+	case NodeEvent::Exists: ++nodeCounters.existenceChecks; return;
+	case NodeEvent::Refine: ++nodeCounters.refinements; break;
+	}
+	const auto nanoseconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+	nodeCounters.nanoseconds += nanoseconds;
+	if (event == NodeEvent::Create) nodeCounters.creationNanoseconds += nanoseconds;
+}
+
+namespace detail {
+
+// The node as declared by the user, rather than as seen from a graph
+template <typename Node>
+struct Unbound {
+	using Type = Node;
+};
+
+template <typename Node, typename Tables>
+struct Unbound<GraphBoundNode<Node, Tables>> {
+	using Type = Node;
+};
+
+/**
+ * Run an operation on a node, notifying its instrumentation policy if any.
+ * Nodes without policy call the operation directly.
+ */
+template <typename Node, typename Operation>
+constexpr decltype(auto) instrument(NodeEvent event, Operation&& operation) {
+	if constexpr (Node::template HasOption<InstrumentationOption>()) {
+		using Policy = typename Node::template Option<InstrumentationOption>::Policy;
+		using Target = typename Unbound<Node>::Type;
+		struct Scope {
+			NodeEvent event;
+			InstrumentationClock::time_point begin = InstrumentationClock::now();
+			explicit Scope(NodeEvent e) : event(e) { Policy::template onBegin<Target>(event, begin); }
+			~Scope() { Policy::template onEnd<Target>(event, begin, InstrumentationClock::now()); }
+		} scope(event);
+		return operation();
+	}
+	else {
+		return operation();
+	}
+}
+
+// Node operations, as called by the algorithms
+
+template <typename Node, typename Context>
+constexpr void instrumentedCreate(Context& ctx) {
+	instrument<Node>(NodeEvent::Create, [&ctx]() { Node::Create(ctx); });
+}
+
+template <typename Node, typename Context>
+constexpr void instrumentedDestroy(Context& ctx) {
+	instrument<Node>(NodeEvent::Destroy, [&ctx]() { Node::Destroy(ctx); });
+}
+
+template <typename Node, typename Context>
+constexpr bool instrumentedExists(Context& ctx) {
+	return instrument<Node>(NodeEvent::Exists, [&ctx]() { return Node::Exists(ctx); });
+}
+
+} // namespace detail
+
+#pragma endregion
+
+} // namespace statdeps
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "algorithms.hpp"
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * Same as rebuild(), except that nothing is created again: the rebuilt
+ * nodes and their existing dependees are only destroyed, hence marked as
+ * stale, and they get recreated by the next ensureExists() or get() that
+ * needs them. Resources that are not needed anymore (e.g., a debug view that
+ * was closed) thus do not pay for the rebuild.
+ *
+ * Since nodes are all destroyed, update callbacks and fingerprints (see
+ * with_update and with_fingerprint) do not apply.
+ */
+template <typename Context, typename Node, typename Graph>
+constexpr void rebuildLazily(Context& ctx, Node, Graph);
+
+template <typename Context, typename... Nodes, typename Graph>
+constexpr void rebuildLazily(Context& ctx, List<Nodes...>, Graph);
+
+/**
+ * On-demand access to a resource, which is created together with its
+ * dependencies when stale, e.g., after rebuildLazily(). The resource is
+ * given as a member of the context, or as a global variable for nodes
+ * without context:
+ *
+ *   using LazyTexture = Lazy<TextureResource, Graph, &Application::m_texture>;
+ *   wgpu::Texture& texture = get<LazyTexture>(*this);
+ */
+template <typename Node, typename Graph, auto resource>
+struct Lazy;
+
+template <typename LazyResource, typename Context>
+constexpr auto& get(Context& ctx);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+template <typename Context, typename Tables, typename... Affected>
+constexpr void destroyUnion(Context& ctx, List<Affected...>) {
+	forEach(revert(List<Affected...>{}), [&ctx](auto node) {
+		destroyResource(ctx, BindNode<decltype(node), Tables>{});
+	});
+}
+
+} // namespace detail
+
+// rebuildLazily()
+
+template <typename Context, typename Node, typename Graph>
+constexpr void rebuildLazily(Context& ctx, Node, Graph) {
+	rebuildLazily(ctx, List<Node>{}, Graph{});
+}
+
+template <typename Context, typename... Nodes, typename Graph>
+constexpr void rebuildLazily(Context& ctx, List<Nodes...>, Graph) {
+	using Tables = typename Graph::Tables;
+	detail::destroyUnion<Context, Tables>(ctx, typename Tables::template DependeeUnionOf<Nodes...>{});
+
+	// Nodes that are not part of the graph have no dependee
+	auto destroyAlone = [&ctx](auto node) {
+		if constexpr (Tables::template IndexOf<decltype(node)> == Tables::NodeCount) {
+			destroyResource(ctx, node);
+		}
+	};
+	(destroyAlone(Nodes{}), ...);
+	(void)destroyAlone;
+}
+
+// Lazy
+
+template <typename Node, typename Graph, auto resource>
+struct Lazy {
+	template <typename Context>
+	static constexpr auto& get(Context& ctx) {
+		ensureExists(ctx, Node{}, Graph{});
+		if constexpr (Node::HasNoContext::value) {
+			return *resource;
+		}
+		else {
+			return ctx.*resource;
+		}
+	}
+};
+
+template <typename LazyResource, typename Context>
+constexpr auto& get(Context& ctx) {
+	return LazyResource::get(ctx);
+}
+
+#pragma endregion
+
+} // namespace statdeps
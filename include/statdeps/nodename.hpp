@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string_view>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A readable name for a node, namely its type name as spelled by the
+ * compiler, e.g., to print or export graphs. A node declared as an alias of a
+ * built DepsNode is named after the DepsNode type, so to get a name of its
+ * own, declare it as a struct that derives from the built type instead:
+ *
+ *     struct TextureResource : DepsNodeBuilder::with_create<...>::build {};
+ */
+template <typename Node>
+constexpr std::string_view nodeName(Node) noexcept;
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+// Extract T from the signature of this function, e.g.,
+//   GCC:   "... typeName() [with T = Foo; std::string_view = ...]"
+//   Clang: "... typeName() [T = Foo]"
+//   MSVC:  "... typeName<struct Foo>(void)"
+template <typename T>
+constexpr std::string_view typeName() noexcept {
+#if defined(__clang__) || defined(__GNUC__)
+	constexpr std::string_view signature = __PRETTY_FUNCTION__;
+	constexpr std::size_t begin = signature.find("T = ") + 4;
+	constexpr std::size_t semicolon = signature.find(';', begin);
+	constexpr std::size_t end = semicolon != std::string_view::npos ? semicolon : signature.rfind(']');
+	return signature.substr(begin, end - begin);
+#elif defined(_MSC_VER)
+	constexpr std::string_view signature = __FUNCSIG__;
+	constexpr std::size_t begin = signature.find("typeName<") + 9;
+	constexpr std::size_t end = signature.rfind(">(void)");
+	constexpr std::string_view name = signature.substr(begin, end - begin);
+	if (name.substr(0, 7) == "struct ") return name.substr(7);
+	if (name.substr(0, 6) == "class ") return name.substr(6);
+	return name;
+#else
+	return "<unknown>";
+#endif
+}
+
+} // namespace detail
+
+template <typename Node>
+constexpr std::string_view nodeName(Node) noexcept {
+	return detail::typeName<Node>();
+}
+
+#pragma endregion
+
+} // namespace statdeps
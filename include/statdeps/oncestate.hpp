@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A ready state that threads calling ensureExists() concurrently can share
+ * (see with_once_state). It goes from absent to creating to ready, and only
+ * the thread that moves it from absent to creating calls the create
+ * callback, while the others wait for this resource only. If the callback
+ * throws, the state goes back to absent and a waiting thread tries again.
+ *
+ * Once ready, checking the state is a single atomic load. Destroying is not
+ * synchronized with creating, so algorithms that destroy resources (e.g.,
+ * rebuild()) must not run concurrently with others on the same nodes.
+ */
+class OnceState {
+public:
+	enum class Value : std::uint8_t {
+		Absent,
+		Creating,
+		Ready,
+	};
+
+	OnceState() = default;
+	OnceState(const OnceState&) = delete;
+	OnceState& operator=(const OnceState&) = delete;
+
+	Value load() const { return m_value.load(std::memory_order_acquire); }
+
+	operator bool() const { return load() == Value::Ready; }
+
+	/**
+	 * Set the state when not racing with other threads, as a ready state
+	 * of type bool would be set
+	 */
+	OnceState& operator=(bool ready);
+
+	/**
+	 * Call the create callback unless the resource is ready or being created
+	 * by another thread, in which case wait until it is ready.
+	 */
+	template <typename Create>
+	void callOnce(Create&& create);
+
+private:
+	void waitWhileCreating() const;
+
+private:
+	std::atomic<Value> m_value{ Value::Absent };
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+inline OnceState& OnceState::operator=(bool ready) {
+	m_value.store(ready ? Value::Ready : Value::Absent, std::memory_order_release);
+#if defined(__cpp_lib_atomic_wait)
+	m_value.notify_all();
+#endif
+	return *this;
+}
+
+template <typename Create>
+void OnceState::callOnce(Create&& create) {
+	for (;;) {
+		Value expected = Value::Absent;
+		if (m_value.compare_exchange_strong(expected, Value::Creating, std::memory_order_acquire)) {
+			try {
+				create();
+			}
+			catch (...) {
+				*this = false;
+				throw;
+			}
+			*this = true;
+			return;
+		}
+		if (expected == Value::Ready) return;
+		waitWhileCreating();
+	}
+}
+
+inline void OnceState::waitWhileCreating() const {
+#if defined(__cpp_lib_atomic_wait)
+	m_value.wait(Value::Creating, std::memory_order_acquire);
+#else
+	while (load() == Value::Creating) {
+		std::this_thread::yield();
+	}
+#endif
+}
+
+#pragma endregion
+
+} // namespace statdeps
@@ -0,0 +1,437 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "algorithms.hpp"
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A work-stealing thread pool, which can be used as the executor of parallel
+ * algorithms. An executor is any callable that accepts a task (a callable
+ * without argument) and eventually runs it, possibly on another thread.
+ *
+ * Each worker has its own queue. Tasks submitted from a worker are pushed to
+ * its queue and run last-in first-out, so that a worker keeps going down the
+ * subtree it is in, while idle workers steal the oldest tasks of the others.
+ */
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void operator()(std::function<void()> task);
+
+private:
+	struct Worker {
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+	};
+
+	void work(std::size_t index);
+	bool tryPop(std::size_t index, std::function<void()>& task);
+
+private:
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+	std::atomic<std::size_t> m_nextWorker{ 0 };
+
+	// Number of tasks queued in any worker, guarded by m_mutex
+	std::size_t m_pending = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+
+	// Pool and worker index of the current thread, if it is a worker
+	inline static thread_local ThreadPool* t_pool = nullptr;
+	inline static thread_local std::size_t t_index = 0;
+};
+
+/**
+ * Same as ensureExists(), but independent resources are created concurrently
+ * by submitting them to the executor. A node is submitted as soon as all of
+ * its dependencies have been created, so there is no synchronization besides
+ * the edges of the graph.
+ *
+ * Nodes built with_main_thread are not submitted to the executor but created
+ * by the calling thread, which blocks until the whole closure is ready.
+ *
+ * If a Create callback throws, no new node is started, and the first
+ * exception is rethrown once the running ones are done. Nodes that have
+ * transient dependencies (see with_transient), or dependencies that their
+ * edges require to refine (see with_levels), cannot be created concurrently,
+ * which is reported at compile time.
+ */
+template <typename Context, typename Node, typename Graph, typename Executor>
+void parallelEnsureExists(Context& ctx, Node, Graph, Executor&& executor);
+
+/**
+ * Same as rebuild(), but independent dependee subtrees are destroyed and
+ * recreated concurrently by submitting them to the executor. A resource is
+ * destroyed only once all of its dependees are destroyed, and recreated only
+ * once all of its dependencies are recreated, so the order of rebuild() is
+ * preserved along every edge.
+ *
+ * Nodes built with_main_thread are handled by the calling thread. If a
+ * callback throws, the exception is rethrown once the running ones are done,
+ * and resources are not recreated if it happened while destroying them.
+ */
+template <typename Context, typename Node, typename Graph, typename Executor>
+void parallelRebuild(Context& ctx, Node, Graph, Executor&& executor);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, thread pool (private)]
+
+inline ThreadPool::ThreadPool(unsigned int threadCount) {
+	if (threadCount == 0) threadCount = 1;
+	m_workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+	m_threads.reserve(threadCount);
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		m_threads.emplace_back([this, i] { work(i); });
+	}
+}
+
+inline ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+inline void ThreadPool::operator()(std::function<void()> task) {
+	std::size_t index = t_pool == this
+		? t_index
+		: m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+	{
+		std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+		m_workers[index]->tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_pending;
+	}
+	m_condition.notify_one();
+}
+
+inline bool ThreadPool::tryPop(std::size_t index, std::function<void()>& task) {
+	{
+		// Newest task of our own queue
+		Worker& worker = *m_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty()) {
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			return true;
+		}
+	}
+	for (std::size_t offset = 1; offset < m_workers.size(); ++offset) {
+		// Oldest task of another queue
+		Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+inline void ThreadPool::work(std::size_t index) {
+	t_pool = this;
+	t_index = index;
+	while (true) {
+		std::function<void()> task;
+		if (tryPop(index, task)) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				--m_pending;
+			}
+			task();
+			continue;
+		}
+		// Remaining tasks are still run when stopping
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait(lock, [this] { return m_stopping || m_pending > 0; });
+		if (m_pending == 0) return;
+	}
+}
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions, parallel algorithms (private)]
+
+namespace detail {
+
+// Per node callbacks and flags of a plan, indexed by local index
+template <template <typename, typename> class Task, typename Context, typename Tables, const auto& Plan, std::size_t... Ks>
+constexpr auto makeTasks(std::index_sequence<Ks...>) noexcept {
+	return std::array<void (*)(Context&, bool), sizeof...(Ks)>{ &Task<Context, BindNode<typename Tables::template NodeAt<Plan.nodes[Ks]>, Tables>>::run... };
+}
+
+template <typename Tables, const auto& Plan, std::size_t... Ks>
+constexpr auto mainThreadFlags(std::index_sequence<Ks...>) noexcept {
+	return std::array<bool, sizeof...(Ks)>{ Tables::template NodeAt<Plan.nodes[Ks]>::RunsOnMainThread()... };
+}
+
+template <typename Context, typename Tables, const auto& Plan, std::size_t... Ks>
+std::array<bool, sizeof...(Ks)> existenceFlags(Context& ctx, std::index_sequence<Ks...>) {
+	return { doesResourceExist(ctx, BindNode<typename Tables::template NodeAt<Plan.nodes[Ks]>, Tables>{}, true)... };
+}
+
+/**
+ * Runtime state of a parallel traversal of a plan, where a node is started
+ * once all the nodes on which it waits are done. The successors of node i in
+ * this traversal are given by the CSR table (offsets, targets), filtered by
+ * the plan: dependees when creating, dependencies when destroying.
+ */
+template <typename Context, std::size_t Count, std::size_t NodeCount, std::size_t EdgeCount>
+class ParallelTraversal {
+public:
+	using Task = void (*)(Context&, bool);
+
+	ParallelTraversal(
+		Context& ctx,
+		const SubgraphPlan<Count, NodeCount>& plan,
+		const std::array<std::size_t, Count>& waitCounts,
+		const std::array<std::size_t, NodeCount + 1>& offsets,
+		const std::array<std::size_t, EdgeCount>& targets,
+		const std::array<Task, Count>& tasks,
+		const std::array<bool, Count>& flags,
+		const std::array<bool, Count>& mainThread
+	)
+		: m_ctx(ctx)
+		, m_plan(plan)
+		, m_remaining(waitCounts)
+		, m_offsets(offsets)
+		, m_targets(targets)
+		, m_tasks(tasks)
+		, m_flags(flags)
+		, m_mainThread(mainThread)
+	{}
+
+	template <typename Executor>
+	void run(Executor& executor) {
+		std::array<std::size_t, Count> ready;
+		std::size_t readyCount = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (std::size_t k = 0; k < Count; ++k) {
+				if (m_remaining[k] == 0) ready[readyCount++] = k;
+			}
+			m_outstanding = readyCount;
+		}
+		dispatch(executor, ready, readyCount);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_condition.wait(lock, [this] { return m_mainBegin != m_mainEnd || isOver(); });
+			if (m_mainBegin != m_mainEnd) {
+				std::size_t k = m_mainQueue[m_mainBegin++];
+				lock.unlock();
+				execute(executor, k);
+				lock.lock();
+			}
+			else {
+				break;
+			}
+		}
+
+		if (m_error) std::rethrow_exception(m_error);
+	}
+
+private:
+	bool isOver() const {
+		return m_finished == Count || (m_error && m_outstanding == 0);
+	}
+
+	// Hand ready nodes over to either the main thread or the executor. Must
+	// be called without holding the lock, since the executor may run the
+	// task immediately.
+	template <typename Executor>
+	void dispatch(Executor& executor, const std::array<std::size_t, Count>& ready, std::size_t readyCount) {
+		for (std::size_t r = 0; r < readyCount; ++r) {
+			std::size_t k = ready[r];
+			if (m_mainThread[k]) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_mainQueue[m_mainEnd++] = k;
+				m_condition.notify_all();
+			}
+			else {
+				executor([this, &executor, k] { execute(executor, k); });
+			}
+		}
+	}
+
+	template <typename Executor>
+	void execute(Executor& executor, std::size_t k) {
+		bool failed;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			failed = static_cast<bool>(m_error);
+		}
+		if (!failed) {
+			try {
+				m_tasks[k](m_ctx, m_flags[k]);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_error) m_error = std::current_exception();
+				failed = true;
+			}
+		}
+		finish(executor, k, failed);
+	}
+
+	template <typename Executor>
+	void finish(Executor& executor, std::size_t k, bool failed) {
+		std::array<std::size_t, Count> ready;
+		std::size_t readyCount = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_outstanding;
+			if (!failed && !m_error) {
+				++m_finished;
+				std::size_t i = m_plan.nodes[k];
+				for (std::size_t e = m_offsets[i]; e < m_offsets[i + 1]; ++e) {
+					std::size_t j = m_plan.local[m_targets[e]];
+					if (j < Count && --m_remaining[j] == 0) {
+						ready[readyCount++] = j;
+					}
+				}
+				m_outstanding += readyCount;
+			}
+			// Once the traversal is over, the calling thread may return and
+			// destroy this object, so it must not be touched after unlocking.
+			if (isOver()) {
+				m_condition.notify_all();
+				return;
+			}
+		}
+		dispatch(executor, ready, readyCount);
+	}
+
+private:
+	Context& m_ctx;
+	const SubgraphPlan<Count, NodeCount>& m_plan;
+	std::array<std::size_t, Count> m_remaining;
+	const std::array<std::size_t, NodeCount + 1>& m_offsets;
+	const std::array<std::size_t, EdgeCount>& m_targets;
+	const std::array<Task, Count>& m_tasks;
+	const std::array<bool, Count>& m_flags;
+	const std::array<bool, Count>& m_mainThread;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::array<std::size_t, Count> m_mainQueue{};
+	std::size_t m_mainBegin = 0;
+	std::size_t m_mainEnd = 0;
+	std::size_t m_finished = 0;
+	std::size_t m_outstanding = 0;
+	std::exception_ptr m_error;
+};
+
+} // namespace detail
+
+// parallelEnsureExists()
+
+template <typename Context, typename Node, typename Graph, typename Executor>
+void parallelEnsureExists(Context& ctx, Node, Graph, Executor&& executor) {
+	using Tables = typename Graph::Tables;
+	constexpr std::size_t I = Tables::template IndexOf<Node>;
+
+	if constexpr (I == Tables::NodeCount) {
+		// The node is not part of the graph, it has no dependency
+		createResource(ctx, Node{});
+	}
+	else {
+		constexpr auto& plan = detail::ensurePlan<Tables, I>;
+		static_assert(detail::allowsConcurrencyOf<Tables, detail::ensurePlan<Tables, I>>, "Nodes with transient dependencies or dependencies to refine (see with_levels) cannot be created concurrently, use ensureExists()");
+		constexpr std::size_t Count = plan.nodes.size();
+		using Indices = std::make_index_sequence<Count>;
+		static constexpr auto tasks = detail::makeTasks<detail::CreateTask, Context, Tables, detail::ensurePlan<Tables, I>>(Indices{});
+		static constexpr auto mainThread = detail::mainThreadFlags<Tables, detail::ensurePlan<Tables, I>>(Indices{});
+		static constexpr std::array<bool, Count> unused{};
+
+		// Nodes wait for their dependencies, and notify their dependees
+		detail::ParallelTraversal<Context, Count, Tables::NodeCount, Tables::EdgeCount> traversal(
+			ctx, plan, plan.dependencyCounts, Tables::dependeeOffsets, Tables::dependees, tasks, unused, mainThread
+		);
+		traversal.run(executor);
+	}
+}
+
+// parallelRebuild()
+
+template <typename Context, typename Node, typename Graph, typename Executor>
+void parallelRebuild(Context& ctx, Node, Graph, Executor&& executor) {
+	using Tables = typename Graph::Tables;
+	constexpr std::size_t I = Tables::template IndexOf<Node>;
+
+	if constexpr (I == Tables::NodeCount) {
+		// The node is not part of the graph, it has no dependee
+		destroyResource(ctx, Node{});
+		createResource(ctx, Node{});
+	}
+	else {
+		constexpr auto& plan = detail::rebuildPlan<Tables, I>;
+		static_assert(detail::allowsConcurrencyOf<Tables, detail::rebuildPlan<Tables, I>>, "Nodes with transient dependencies or dependencies to refine (see with_levels) cannot be created concurrently, use rebuild()");
+		constexpr std::size_t Count = plan.nodes.size();
+		using Indices = std::make_index_sequence<Count>;
+		static constexpr auto destroyTasks = detail::makeTasks<detail::DestroyExistingTask, Context, Tables, detail::rebuildPlan<Tables, I>>(Indices{});
+		static constexpr auto createTasks = detail::makeTasks<detail::CreateMissingTask, Context, Tables, detail::rebuildPlan<Tables, I>>(Indices{});
+		static constexpr auto mainThread = detail::mainThreadFlags<Tables, detail::rebuildPlan<Tables, I>>(Indices{});
+
+		// Same as rebuild(): only dependees that existed are recreated, but
+		// the rebuilt node itself (at local index 0) is always recreated.
+		std::array<bool, Count> existed = detail::existenceFlags<Context, Tables, detail::rebuildPlan<Tables, I>>(ctx, Indices{});
+		{
+			// Nodes wait for their dependees, and notify their dependencies
+			detail::ParallelTraversal<Context, Count, Tables::NodeCount, Tables::EdgeCount> traversal(
+				ctx, plan, plan.dependeeCounts, Tables::dependencyOffsets, Tables::dependencies, destroyTasks, existed, mainThread
+			);
+			traversal.run(executor);
+		}
+		existed[0] = true;
+		{
+			// Nodes wait for their dependencies, and notify their dependees
+			detail::ParallelTraversal<Context, Count, Tables::NodeCount, Tables::EdgeCount> traversal(
+				ctx, plan, plan.dependencyCounts, Tables::dependeeOffsets, Tables::dependees, createTasks, existed, mainThread
+			);
+			traversal.run(executor);
+		}
+	}
+}
+
+#pragma endregion
+
+} // namespace statdeps
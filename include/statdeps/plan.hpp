@@ -0,0 +1,135 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "algorithms.hpp"
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * The algorithms of a graph for a given context, compiled once for all of its
+ * nodes, so that a translation unit can use them without instantiating them
+ * again. Calls are dispatched on the index of the node through a table of
+ * functions, and otherwise behave like ensureExists(), rebuild() and
+ * isClosureReady().
+ *
+ * Without anything else, a GraphPlan is instantiated implicitly like any
+ * template. To build it in a single translation unit, declare it in a header
+ * after the context and its graph:
+ *
+ *     extern template class statdeps::GraphPlan<Application, Application::Graph>;
+ *
+ * and instantiate it in one source file:
+ *
+ *     template class statdeps::GraphPlan<Application, Application::Graph>;
+ *
+ * Other translation units then only evaluate the tables of the graph (to get
+ * the index of nodes), but none of the algorithms.
+ */
+template <typename Context, typename Graph>
+class GraphPlan {
+public:
+	using Tables = typename Graph::Tables;
+
+	template <typename Node>
+	static void ensureExists(Context& ctx, Node) { ensureExistsAt(ctx, indexOf<Node>()); }
+
+	template <typename Node>
+	static void rebuild(Context& ctx, Node) { rebuildAt(ctx, indexOf<Node>()); }
+
+	template <typename Node>
+	static bool isClosureReady(Context& ctx, Node) { return isClosureReadyAt(ctx, indexOf<Node>()); }
+
+	/**
+	 * Same as above for the node at index i in the graph tables (see
+	 * GraphTables::IndexOf), which must be lower than Tables::NodeCount.
+	 */
+	static void ensureExistsAt(Context& ctx, std::size_t i);
+	static void rebuildAt(Context& ctx, std::size_t i);
+	static bool isClosureReadyAt(Context& ctx, std::size_t i);
+
+private:
+	template <typename Node>
+	static constexpr std::size_t indexOf() noexcept;
+
+	template <std::size_t... Is>
+	static constexpr auto ensureTable(std::index_sequence<Is...>) noexcept;
+
+	template <std::size_t... Is>
+	static constexpr auto rebuildTable(std::index_sequence<Is...>) noexcept;
+
+	template <std::size_t... Is>
+	static constexpr auto readyTable(std::index_sequence<Is...>) noexcept;
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+template <typename Context, typename Graph>
+template <typename Node>
+constexpr std::size_t GraphPlan<Context, Graph>::indexOf() noexcept {
+	constexpr std::size_t i = Tables::template IndexOf<Node>;
+	static_assert(i < Tables::NodeCount, "A GraphPlan can only be used with the nodes of its graph");
+	return i;
+}
+
+template <typename Context, typename Graph>
+template <std::size_t... Is>
+constexpr auto GraphPlan<Context, Graph>::ensureTable(std::index_sequence<Is...>) noexcept {
+	using Function = void (*)(Context&);
+	return std::array<Function, sizeof...(Is)>{
+		static_cast<Function>([](Context& ctx) { statdeps::ensureExists(ctx, typename Tables::template NodeAt<Is>{}, Graph{}); })...
+	};
+}
+
+template <typename Context, typename Graph>
+template <std::size_t... Is>
+constexpr auto GraphPlan<Context, Graph>::rebuildTable(std::index_sequence<Is...>) noexcept {
+	using Function = void (*)(Context&);
+	return std::array<Function, sizeof...(Is)>{
+		static_cast<Function>([](Context& ctx) { statdeps::rebuild(ctx, typename Tables::template NodeAt<Is>{}, Graph{}); })...
+	};
+}
+
+template <typename Context, typename Graph>
+template <std::size_t... Is>
+constexpr auto GraphPlan<Context, Graph>::readyTable(std::index_sequence<Is...>) noexcept {
+	using Function = bool (*)(Context&);
+	return std::array<Function, sizeof...(Is)>{
+		static_cast<Function>([](Context& ctx) { return statdeps::isClosureReady(ctx, typename Tables::template NodeAt<Is>{}, Graph{}); })...
+	};
+}
+
+// These are not inline, so that an explicit instantiation declaration of the
+// plan prevents other translation units from instantiating them.
+
+template <typename Context, typename Graph>
+void GraphPlan<Context, Graph>::ensureExistsAt(Context& ctx, std::size_t i) {
+	static constexpr auto table = ensureTable(std::make_index_sequence<Tables::NodeCount>{});
+	table[i](ctx);
+}
+
+template <typename Context, typename Graph>
+void GraphPlan<Context, Graph>::rebuildAt(Context& ctx, std::size_t i) {
+	static constexpr auto table = rebuildTable(std::make_index_sequence<Tables::NodeCount>{});
+	table[i](ctx);
+}
+
+template <typename Context, typename Graph>
+bool GraphPlan<Context, Graph>::isClosureReadyAt(Context& ctx, std::size_t i) {
+	static constexpr auto table = readyTable(std::make_index_sequence<Tables::NodeCount>{});
+	return table[i](ctx);
+}
+
+#pragma endregion
+
+} // namespace statdeps
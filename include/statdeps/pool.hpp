@@ -0,0 +1,191 @@
+#pragma once
+
+#include <new>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A reference to a resource of a ResourcePool, which tells when it has been
+ * released, even if its slot has been reused by another resource since then.
+ */
+template <typename T>
+struct Handle {
+	static constexpr std::uint32_t InvalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+	std::uint32_t index = InvalidIndex;
+	std::uint32_t generation = 0;
+
+	explicit operator bool() const { return index != InvalidIndex; }
+	bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+/**
+ * Storage for many resources of a same type, e.g., one per context for a
+ * node built with_pool, which the node constructs in place when created and
+ * releases when destroyed, without allocating once the pool is warm.
+ *
+ * Slots are allocated by chunks that never move, so resources have stable
+ * addresses and are contiguous in memory. The last released slot is the
+ * first one reused, so that destroying then creating a resource, as rebuild
+ * does, gives back the same slot.
+ */
+template <typename T, std::size_t ChunkSize = 64>
+class ResourcePool {
+public:
+	ResourcePool() = default;
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+	~ResourcePool();
+
+	template <typename... Args>
+	Handle<T> emplace(Args&&... args);
+
+	/**
+	 * Construct the value returned by the factory directly in its slot,
+	 * without moving it (see with_pool)
+	 */
+	template <typename Factory>
+	Handle<T> emplaceWith(Factory&& factory);
+
+	/**
+	 * Destroy the resource, if the handle is still valid
+	 */
+	void release(Handle<T> handle);
+
+	/**
+	 * The resource, or nullptr if the handle is not valid anymore
+	 */
+	T* get(Handle<T> handle);
+	const T* get(Handle<T> handle) const;
+
+	bool contains(Handle<T> handle) const { return get(handle) != nullptr; }
+	std::size_t size() const { return m_size; }
+
+	/**
+	 * Allocate enough chunks for the given number of resources
+	 */
+	void reserve(std::size_t count);
+
+	/**
+	 * Release all resources
+	 */
+	void clear();
+
+private:
+	struct Slot {
+		alignas(T) unsigned char storage[sizeof(T)];
+		std::uint32_t generation = 0;
+		std::uint32_t nextFree = Handle<T>::InvalidIndex;
+		bool alive = false;
+
+		T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+		const T* value() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+	};
+
+	Slot& slot(std::uint32_t index) { return m_chunks[index / ChunkSize][index % ChunkSize]; }
+	const Slot& slot(std::uint32_t index) const { return m_chunks[index / ChunkSize][index % ChunkSize]; }
+	void addChunk();
+
+private:
+	std::vector<std::unique_ptr<Slot[]>> m_chunks;
+	std::uint32_t m_firstFree = Handle<T>::InvalidIndex;
+	std::size_t m_size = 0;
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+template <typename T, std::size_t ChunkSize>
+ResourcePool<T, ChunkSize>::~ResourcePool() {
+	clear();
+}
+
+template <typename T, std::size_t ChunkSize>
+void ResourcePool<T, ChunkSize>::addChunk() {
+	const std::uint32_t first = static_cast<std::uint32_t>(m_chunks.size() * ChunkSize);
+	m_chunks.push_back(std::make_unique<Slot[]>(ChunkSize));
+
+	// Thread new slots in front of the free list, in increasing order
+	for (std::size_t k = ChunkSize; k-- > 0;) {
+		Slot& newSlot = m_chunks.back()[k];
+		newSlot.nextFree = m_firstFree;
+		m_firstFree = first + static_cast<std::uint32_t>(k);
+	}
+}
+
+template <typename T, std::size_t ChunkSize>
+template <typename... Args>
+Handle<T> ResourcePool<T, ChunkSize>::emplace(Args&&... args) {
+	return emplaceWith([&args...]() { return T(std::forward<Args>(args)...); });
+}
+
+template <typename T, std::size_t ChunkSize>
+template <typename Factory>
+Handle<T> ResourcePool<T, ChunkSize>::emplaceWith(Factory&& factory) {
+	if (m_firstFree == Handle<T>::InvalidIndex) addChunk();
+	const std::uint32_t index = m_firstFree;
+	Slot& target = slot(index);
+
+	// The returned prvalue initializes the slot, and the slot stays free if
+	// the factory throws
+	new (target.storage) T(factory());
+	m_firstFree = target.nextFree;
+	target.alive = true;
+	++m_size;
+	return { index, target.generation };
+}
+
+template <typename T, std::size_t ChunkSize>
+void ResourcePool<T, ChunkSize>::release(Handle<T> handle) {
+	if (!contains(handle)) return;
+	Slot& target = slot(handle.index);
+	target.value()->~T();
+	target.alive = false;
+	++target.generation;
+	target.nextFree = m_firstFree;
+	m_firstFree = handle.index;
+	--m_size;
+}
+
+template <typename T, std::size_t ChunkSize>
+T* ResourcePool<T, ChunkSize>::get(Handle<T> handle) {
+	return const_cast<T*>(static_cast<const ResourcePool&>(*this).get(handle));
+}
+
+template <typename T, std::size_t ChunkSize>
+const T* ResourcePool<T, ChunkSize>::get(Handle<T> handle) const {
+	if (handle.index >= m_chunks.size() * ChunkSize) return nullptr;
+	const Slot& target = slot(handle.index);
+	if (!target.alive || target.generation != handle.generation) return nullptr;
+	return target.value();
+}
+
+template <typename T, std::size_t ChunkSize>
+void ResourcePool<T, ChunkSize>::reserve(std::size_t count) {
+	while (m_chunks.size() * ChunkSize < count) addChunk();
+}
+
+template <typename T, std::size_t ChunkSize>
+void ResourcePool<T, ChunkSize>::clear() {
+	const std::uint32_t slotCount = static_cast<std::uint32_t>(m_chunks.size() * ChunkSize);
+	for (std::uint32_t index = 0; index < slotCount; ++index) {
+		Slot& target = slot(index);
+		if (target.alive) release({ index, target.generation });
+	}
+}
+
+#pragma endregion
+
+} // namespace statdeps
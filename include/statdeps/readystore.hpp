@@ -0,0 +1,134 @@
+#pragma once
+
+#include "depsgraph.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * Packed ready states of the nodes of a graph, one bit per node at the index
+ * of the node in the graph tables. Nodes opt in with with_ready_store, and
+ * the capacity must be at least the number of nodes of the graph.
+ *
+ * Since the ready states of a closure are gathered in a few words, checking
+ * that it is entirely ready is a single mask test (see isClosureReady()).
+ *
+ * Words are atomic, so that the parallel executors may set the bits of nodes
+ * that share a word from different threads. Ordering with respect to the
+ * resources is given by the executor, so bits are accessed relaxed.
+ */
+template <std::size_t CapacityValue = 64>
+class ReadyStore {
+public:
+	static constexpr std::size_t Capacity = CapacityValue;
+	static constexpr std::size_t WordCount = (Capacity + 63) / 64;
+	using Mask = std::array<std::uint64_t, WordCount>;
+
+	// Proxy to a single bit, so that it can be used in place of a bool&
+	class Reference;
+
+	bool test(std::size_t i) const;
+	void set(std::size_t i, bool value);
+	Reference operator[](std::size_t i);
+
+	// Whether all the bits of the mask are set
+	bool contains(const Mask& mask) const;
+
+	void clear();
+
+private:
+	std::array<std::atomic<std::uint64_t>, WordCount> m_words{};
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+template <std::size_t CapacityValue>
+class ReadyStore<CapacityValue>::Reference {
+public:
+	Reference(ReadyStore& store, std::size_t i) : m_store(store), m_index(i) {}
+
+	operator bool() const { return m_store.test(m_index); }
+
+	Reference& operator=(bool value) {
+		m_store.set(m_index, value);
+		return *this;
+	}
+
+private:
+	ReadyStore& m_store;
+	std::size_t m_index;
+};
+
+template <std::size_t CapacityValue>
+bool ReadyStore<CapacityValue>::test(std::size_t i) const {
+	return (m_words[i / 64].load(std::memory_order_relaxed) >> (i % 64)) & 1;
+}
+
+template <std::size_t CapacityValue>
+void ReadyStore<CapacityValue>::set(std::size_t i, bool value) {
+	std::uint64_t bit = std::uint64_t(1) << (i % 64);
+	if (value) m_words[i / 64].fetch_or(bit, std::memory_order_relaxed);
+	else m_words[i / 64].fetch_and(~bit, std::memory_order_relaxed);
+}
+
+template <std::size_t CapacityValue>
+typename ReadyStore<CapacityValue>::Reference ReadyStore<CapacityValue>::operator[](std::size_t i) {
+	return Reference(*this, i);
+}
+
+template <std::size_t CapacityValue>
+bool ReadyStore<CapacityValue>::contains(const Mask& mask) const {
+	bool result = true;
+	for (std::size_t w = 0; w < WordCount; ++w) {
+		result = result && (m_words[w].load(std::memory_order_relaxed) & mask[w]) == mask[w];
+	}
+	return result;
+}
+
+template <std::size_t CapacityValue>
+void ReadyStore<CapacityValue>::clear() {
+	for (std::atomic<std::uint64_t>& word : m_words) {
+		word.store(0, std::memory_order_relaxed);
+	}
+}
+
+namespace detail {
+
+// Whether all nodes use the same ReadyStore
+template <typename First, typename... Nodes>
+constexpr bool shareReadyStore() {
+	if constexpr (First::template HasOption<ReadyStoreOption>()) {
+		using Store = typename First::template Option<ReadyStoreOption>;
+		return (std::is_same_v<typename Nodes::template Option<ReadyStoreOption>, Store> && ...);
+	}
+	else {
+		return false;
+	}
+}
+
+template <std::size_t WordCount, std::size_t Count>
+constexpr std::array<std::uint64_t, WordCount> storeMask(const std::array<std::size_t, Count>& indices, std::size_t extra) {
+	std::array<std::uint64_t, WordCount> mask{};
+	for (std::size_t k = 0; k < Count; ++k) {
+		mask[indices[k] / 64] |= std::uint64_t(1) << (indices[k] % 64);
+	}
+	mask[extra / 64] |= std::uint64_t(1) << (extra % 64);
+	return mask;
+}
+
+} // namespace detail
+
+#pragma endregion
+
+} // namespace statdeps
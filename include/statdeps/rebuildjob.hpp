@@ -0,0 +1,160 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "algorithms.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A rebuild() that can be spread over several calls, typically one per frame,
+ * so that rebuilding many resources does not cause a hitch. A job goes
+ * through the same sequence of steps as rebuild(), each of which destroys or
+ * creates a single resource:
+ *
+ *  - destroy the dependees that existed, from the last one to the first one,
+ *  - destroy then create the node itself,
+ *  - create the dependees that existed, from the first one to the last one.
+ *
+ * Until the job is done, the resources it handles are in an intermediate
+ * state, so other algorithms must not be called on them meanwhile. If a step
+ * throws, it is not considered done and the next call to step() retries it.
+ */
+template <typename Context, typename Node, typename Graph>
+class RebuildJob;
+
+/**
+ * Start rebuilding a node, i.e., check which of its dependees exist, without
+ * destroying or creating anything yet.
+ */
+template <typename Context, typename Node, typename Graph>
+RebuildJob<Context, Node, Graph> beginRebuild(Context& ctx, Node, Graph);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+// Create a node, then record the decision about it (see with_trace)
+template <typename Context, typename Tables, bool IsRoot, typename Node>
+struct CreateAndTraceTask {
+	static void run(Context& ctx, bool shouldCreate) {
+		createMissingResource(ctx, Node{}, shouldCreate);
+		traceRebuilt<Tables, IsRoot>(ctx, Node{}, shouldCreate);
+	}
+};
+
+template <typename Context, typename Tables, typename Node, typename Dependees>
+struct RebuildSteps;
+
+template <typename Context, typename Tables, typename Node, typename... Dependees>
+struct RebuildSteps<Context, Tables, Node, List<Dependees...>> {
+	static constexpr std::size_t Count = sizeof...(Dependees);
+	static constexpr std::size_t StepCount = 2 * Count + 2;
+
+	using Step = void (*)(Context&, bool);
+
+	// Flags passed to each step: whether each dependee existed, then whether
+	// the node existed and finally true, since the node is always created.
+	using Flags = std::array<bool, Count + 2>;
+
+	static Flags existence(Context& ctx) {
+		return { doesResourceExist(ctx, Dependees{}, true)..., doesResourceExist(ctx, Node{}, true), true };
+	}
+
+	static constexpr std::array<Step, StepCount> steps = [] {
+		constexpr std::array<Step, Count> destroys = { &DestroyExistingTask<Context, Dependees>::run... };
+		constexpr std::array<Step, Count> creates = { &CreateAndTraceTask<Context, Tables, false, Dependees>::run... };
+		std::array<Step, StepCount> steps{};
+		for (std::size_t k = 0; k < Count; ++k) steps[k] = destroys[Count - 1 - k];
+		steps[Count] = &DestroyExistingTask<Context, Node>::run;
+		steps[Count + 1] = &CreateAndTraceTask<Context, Tables, true, Node>::run;
+		for (std::size_t k = 0; k < Count; ++k) steps[Count + 2 + k] = creates[k];
+		return steps;
+	}();
+
+	static constexpr std::array<std::size_t, StepCount> flagIndices = [] {
+		std::array<std::size_t, StepCount> indices{};
+		for (std::size_t k = 0; k < Count; ++k) indices[k] = Count - 1 - k;
+		indices[Count] = Count;
+		indices[Count + 1] = Count + 1;
+		for (std::size_t k = 0; k < Count; ++k) indices[Count + 2 + k] = k;
+		return indices;
+	}();
+};
+
+} // namespace detail
+
+template <typename Context, typename Node, typename Graph>
+class RebuildJob {
+private:
+	using Tables = typename Graph::Tables;
+	using Steps = detail::RebuildSteps<Context, Tables, detail::BindNode<Node, Tables>, decltype(detail::bindNodes<Tables>(allDependees(Node{}, Graph{})))>;
+
+public:
+	static constexpr std::size_t StepCount = Steps::StepCount;
+
+	explicit RebuildJob(Context& ctx)
+		: m_flags(Steps::existence(ctx))
+	{}
+
+	bool done() const { return m_next == StepCount; }
+	std::size_t completedSteps() const { return m_next; }
+	float progress() const { return static_cast<float>(m_next) / StepCount; }
+
+	/**
+	 * Run the next step, if any. Return true once the job is done.
+	 */
+	bool step(Context& ctx) {
+		if (m_next < StepCount) {
+			Steps::steps[m_next](ctx, m_flags[Steps::flagIndices[m_next]]);
+			++m_next;
+		}
+		return done();
+	}
+
+	/**
+	 * Run steps until the job is done or the budget is spent. At least one
+	 * step is run, and a step that has started is never interrupted, so the
+	 * budget may be exceeded by the duration of the last step.
+	 * Return true once the job is done.
+	 */
+	template <typename Rep, typename Period>
+	bool step(Context& ctx, std::chrono::duration<Rep, Period> budget) {
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point start = Clock::now();
+		do {
+			step(ctx);
+		} while (!done() && Clock::now() - start < budget);
+		return done();
+	}
+
+	/**
+	 * Run all remaining steps.
+	 */
+	void finish(Context& ctx) {
+		while (!step(ctx)) {}
+	}
+
+private:
+	typename Steps::Flags m_flags;
+	std::size_t m_next = 0;
+};
+
+template <typename Context, typename Node, typename Graph>
+RebuildJob<Context, Node, Graph> beginRebuild(Context& ctx, Node, Graph) {
+	return RebuildJob<Context, Node, Graph>(ctx);
+}
+
+#pragma endregion
+
+} // namespace statdeps
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "depsgraph.hpp"
+#include "graphtables.hpp"
+#include "boundnode.hpp"
+#include "algorithms.hpp"
+
+#include <array>
+#include <tuple>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <type_traits>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * A rebuild that keeps the current resources alive and in place until their
+ * replacements are all ready, so that they can still be used meanwhile,
+ * e.g., to keep rendering frames with the old pipeline while the new one is
+ * being created. The steps are:
+ *
+ *  - create a new output for the node and for each dependee that exists,
+ *    from the first one to the last one, beside the current ones,
+ *  - swap all of them with the current outputs at once,
+ *  - destroy the old outputs, from the last one to the first one.
+ *
+ * The new outputs are created by the producers of the nodes (see
+ * with_output), which receive the new outputs of the rebuilt dependencies
+ * and the current outputs of the others. So that nodes can be duplicated,
+ * the rebuilt nodes must all be with_output or have no create callback
+ * (e.g., an abstract input node), and must not be transient. Destroy
+ * callbacks are called with the old output temporarily swapped back in
+ * place, then the old output itself is destroyed. Both the creation of new
+ * outputs and the destruction of old ones are reported to the
+ * instrumentation policy of the node, if any.
+ *
+ * Like with RebuildJob, steps can be spread over several calls, and other
+ * algorithms must not be called on the rebuilt nodes until the job is done.
+ */
+template <typename Context, typename Node, typename Graph>
+class ShadowRebuildJob;
+
+/**
+ * Start a shadowed rebuild, i.e., check which dependees exist without
+ * creating or destroying anything yet.
+ */
+template <typename Context, typename Node, typename Graph>
+ShadowRebuildJob<Context, Node, Graph> beginShadowedRebuild(Context& ctx, Node, Graph);
+
+/**
+ * Run all the steps of a ShadowRebuildJob at once, which still destroys the
+ * old resources only once the new ones are all ready.
+ */
+template <typename Context, typename Node, typename Graph>
+void rebuildShadowed(Context& ctx, Node, Graph);
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+namespace detail {
+
+// Placeholder for the outputs of nodes that have none
+struct NoOutput {};
+
+template <typename Context, typename Node, bool = Node::template HasOption<OutputOption>()>
+struct ShadowOf {
+	using Type = NoOutput;
+};
+
+template <typename Context, typename Node>
+struct ShadowOf<Context, Node, true> {
+	using Type = std::remove_reference_t<decltype(outputOf<Node>(std::declval<Context&>()))>;
+};
+
+template <typename Context, typename Tables, typename Affected>
+struct ShadowSteps;
+
+// Affected nodes are the rebuilt node then its dependees, in topological order
+template <typename Context, typename Tables, typename... Affected>
+struct ShadowSteps<Context, Tables, List<Affected...>> {
+	static constexpr std::size_t Count = sizeof...(Affected);
+	static constexpr std::size_t StepCount = 2 * Count + 1;
+
+	static_assert(((Affected::template HasOption<OutputOption>() || !Affected::UseCreate()) && ...), "Nodes rebuilt by rebuildShadowed() must be with_output or have no create callback");
+	static_assert((!Affected::template HasOption<TransientOption>() && ...), "Nodes rebuilt by rebuildShadowed() cannot be transient");
+
+	using Shadows = std::tuple<std::optional<typename ShadowOf<Context, Affected>::Type>...>;
+	using Flags = std::array<bool, Count>;
+	using Step = void (*)(Context&, Shadows&, const Flags&);
+
+	template <std::size_t K>
+	using AffectedAt = TypeAt<K, Affected...>;
+
+	static constexpr std::size_t localIndex(std::size_t i) {
+		constexpr auto& indices = indicesOf<Tables, Affected...>;
+		for (std::size_t k = 0; k < Count; ++k) {
+			if (indices[k] == i) return k;
+		}
+		return Count;
+	}
+
+	// Whether each node is rebuilt: the first one always is, and dependees
+	// are if they exist, in which case so do their dependencies.
+	static Flags rebuiltFlags(Context& ctx) {
+		Flags flags = { doesResourceExist(ctx, BindNode<Affected, Tables>{}, true)... };
+		flags[0] = true;
+		return flags;
+	}
+
+	// The new output of the dependency at graph index D if it is rebuilt,
+	// or its current output otherwise
+	template <std::size_t D>
+	static const auto& inputOf(Context& ctx, Shadows& shadows) {
+		constexpr std::size_t L = localIndex(D);
+		if constexpr (L < Count) {
+			return *std::get<L>(shadows);
+		}
+		else {
+			return std::as_const(outputOf<typename Tables::template NodeAt<D>>(ctx));
+		}
+	}
+
+	template <typename Node, std::size_t... Ks>
+	static auto produce(Context& ctx, Shadows& shadows, std::index_sequence<Ks...>) {
+		constexpr auto producer = Node::template Option<OutputOption>::function;
+		constexpr auto& dependencies = dependenciesWith<Tables, Tables::template IndexOf<Node>, OutputOption>;
+		if constexpr (Node::HasNoContext::value) {
+			return producer(inputOf<dependencies[Ks]>(ctx, shadows)...);
+		}
+		else {
+			return (ctx.*producer)(inputOf<dependencies[Ks]>(ctx, shadows)...);
+		}
+	}
+
+	template <std::size_t K>
+	static void create(Context& ctx, Shadows& shadows, const Flags& rebuilt) {
+		using Node = AffectedAt<K>;
+		if constexpr (Node::template HasOption<OutputOption>()) {
+			if (!rebuilt[K]) return;
+			constexpr std::size_t InputCount = dependenciesWith<Tables, Tables::template IndexOf<Node>, OutputOption>.size();
+			instrument<Node>(NodeEvent::Create, [&]() {
+				std::get<K>(shadows).emplace(produce<Node>(ctx, shadows, std::make_index_sequence<InputCount>{}));
+			});
+		}
+	}
+
+	template <std::size_t... Ks>
+	static void swapAll(Context& ctx, Shadows& shadows, const Flags& rebuilt, std::index_sequence<Ks...>) {
+		auto swapOne = [&](auto k) {
+			constexpr std::size_t K = decltype(k)::value;
+			using Node = AffectedAt<K>;
+			if constexpr (Node::template HasOption<OutputOption>()) {
+				if (rebuilt[K]) {
+					using std::swap;
+					swap(outputOf<Node>(ctx), *std::get<K>(shadows));
+				}
+			}
+		};
+		(swapOne(std::integral_constant<std::size_t, Ks>{}), ...);
+
+		// The rebuilt node may not have existed before
+		using Root = BindNode<AffectedAt<0>, Tables>;
+		if constexpr (Root::UseReadyState()) {
+			if (!Root::ReadyState(ctx)) {
+				std::get<0>(shadows).reset();
+				Root::ReadyState(ctx) = true;
+			}
+		}
+	}
+
+	static void swap(Context& ctx, Shadows& shadows, const Flags& rebuilt) {
+		swapAll(ctx, shadows, rebuilt, std::index_sequence_for<Affected...>{});
+	}
+
+	template <std::size_t K>
+	static void destroy(Context& ctx, Shadows& shadows, const Flags&) {
+		using Node = AffectedAt<K>;
+		if constexpr (Node::template HasOption<OutputOption>()) {
+			auto& old = std::get<K>(shadows);
+			if (!old) return;
+			using std::swap;
+			swap(outputOf<Node>(ctx), *old);
+			instrumentedDestroy<Node>(ctx);
+			swap(outputOf<Node>(ctx), *old);
+			old.reset();
+		}
+	}
+};
+
+template <typename Steps, std::size_t... Ks>
+constexpr std::array<typename Steps::Step, Steps::StepCount> makeShadowSteps(std::index_sequence<Ks...>) {
+	constexpr std::size_t Count = Steps::Count;
+	constexpr std::array<typename Steps::Step, Count> creates = { &Steps::template create<Ks>... };
+	constexpr std::array<typename Steps::Step, Count> destroys = { &Steps::template destroy<Ks>... };
+	std::array<typename Steps::Step, Steps::StepCount> steps{};
+	for (std::size_t k = 0; k < Count; ++k) steps[k] = creates[k];
+	steps[Count] = &Steps::swap;
+	for (std::size_t k = 0; k < Count; ++k) steps[Count + 1 + k] = destroys[Count - 1 - k];
+	return steps;
+}
+
+template <typename Steps>
+inline constexpr auto shadowSteps = makeShadowSteps<Steps>(std::make_index_sequence<Steps::Count>{});
+
+} // namespace detail
+
+template <typename Context, typename Node, typename Graph>
+class ShadowRebuildJob {
+private:
+	using Tables = typename Graph::Tables;
+	static_assert(Tables::template IndexOf<Node> < Tables::NodeCount, "rebuildShadowed() only applies to nodes of the graph");
+	using Steps = detail::ShadowSteps<Context, Tables, decltype(prepend(Node{}, allDependees(Node{}, Graph{})))>;
+
+public:
+	static constexpr std::size_t StepCount = Steps::StepCount;
+
+	explicit ShadowRebuildJob(Context& ctx)
+		: m_rebuilt(Steps::rebuiltFlags(ctx))
+	{}
+
+	bool done() const { return m_next == StepCount; }
+	std::size_t completedSteps() const { return m_next; }
+	float progress() const { return static_cast<float>(m_next) / StepCount; }
+
+	/**
+	 * Whether the new resources have replaced the old ones
+	 */
+	bool swapped() const { return m_next > Steps::Count; }
+
+	/**
+	 * Run the next step, if any. Return true once the job is done.
+	 */
+	bool step(Context& ctx) {
+		if (m_next < StepCount) {
+			detail::shadowSteps<Steps>[m_next](ctx, m_shadows, m_rebuilt);
+			++m_next;
+		}
+		return done();
+	}
+
+	/**
+	 * Run steps until the job is done or the budget is spent, like
+	 * RebuildJob::step(). Return true once the job is done.
+	 */
+	template <typename Rep, typename Period>
+	bool step(Context& ctx, std::chrono::duration<Rep, Period> budget) {
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point start = Clock::now();
+		do {
+			step(ctx);
+		} while (!done() && Clock::now() - start < budget);
+		return done();
+	}
+
+	/**
+	 * Run all remaining steps.
+	 */
+	void finish(Context& ctx) {
+		while (!step(ctx)) {}
+	}
+
+private:
+	typename Steps::Flags m_rebuilt;
+	typename Steps::Shadows m_shadows;
+	std::size_t m_next = 0;
+};
+
+template <typename Context, typename Node, typename Graph>
+ShadowRebuildJob<Context, Node, Graph> beginShadowedRebuild(Context& ctx, Node, Graph) {
+	return ShadowRebuildJob<Context, Node, Graph>(ctx);
+}
+
+template <typename Context, typename Node, typename Graph>
+void rebuildShadowed(Context& ctx, Node, Graph) {
+	beginShadowedRebuild(ctx, Node{}, Graph{}).finish(ctx);
+}
+
+#pragma endregion
+
+} // namespace statdeps
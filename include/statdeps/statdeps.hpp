@@ -2,3 +2,9 @@
 
 #include "depsgraph.hpp"
 #include "algorithms.hpp"
+#include "rebuildjob.hpp"
+#include "shadow.hpp"
+#include "dirtyset.hpp"
+#include "lazy.hpp"
+#include "batch.hpp"
+#include "plan.hpp"
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace statdeps {
+
+////////////////////////////////////////////////////
+#pragma region [Declarations (public)]
+
+/**
+ * What an algorithm did with a node (see with_trace)
+ */
+enum class TraceAction : std::uint8_t {
+	Created,
+	Rebuilt, // destroyed if it existed, then created again
+	Updated, // in place (see with_update)
+	Skipped,
+};
+
+/**
+ * Why an algorithm did what it did with a node (see with_trace)
+ */
+enum class TraceReason : std::uint8_t {
+	Missing, // it did not exist, so ensureExists() created it or rebuild() left it absent
+	AlreadyExists, // ensureExists() had nothing to do
+	Transient, // ensureExists() only creates transient dependencies when needed
+	Requested, // it is a node that rebuild() was asked to rebuild
+	DependencyChanged, // one of its dependencies was rebuilt or changed
+	UpdateFailed, // its update callback returned false, so it was rebuilt instead
+	DependenciesUnchanged, // its dependencies were updated in place or kept the same fingerprint
+};
+
+constexpr const char* toString(TraceAction action) noexcept;
+constexpr const char* toString(TraceReason reason) noexcept;
+
+/**
+ * A decision recorded by an algorithm about a node of a graph: the index of
+ * the node in the graph, its name (see nodeName) and what was done and why.
+ */
+struct TraceEntry {
+	std::uint32_t node = 0;
+	std::string_view name;
+	TraceAction action = TraceAction::Skipped;
+	TraceReason reason = TraceReason::AlreadyExists;
+};
+
+/**
+ * A fixed-size ring buffer of the last decisions taken by ensureExists() and
+ * rebuild() about the nodes that use it (see with_trace), as well as by
+ * DirtySet::flush(), RebuildJob, GraphPlan and the batched algorithms. The
+ * parallel, asynchronous, lazy and shadowed algorithms record nothing.
+ * Recording an entry does not allocate nor print anything, and once full the
+ * oldest entries are overwritten. The buffer is not synchronized, so it must
+ * not be shared by threads that call algorithms concurrently.
+ */
+template <std::size_t Capacity = 64>
+class TraceBuffer {
+public:
+	static_assert(Capacity > 0, "A TraceBuffer must be able to hold at least one entry");
+
+	void record(const TraceEntry& entry) noexcept;
+
+	/**
+	 * Number of entries currently held, at most Capacity
+	 */
+	std::size_t size() const noexcept;
+
+	/**
+	 * The k-th entry currently held, from the oldest one
+	 */
+	const TraceEntry& operator[](std::size_t k) const noexcept;
+
+	/**
+	 * Number of entries ever recorded, including the overwritten ones
+	 */
+	std::uint64_t recorded() const noexcept { return m_recorded; }
+
+	void clear() noexcept { m_recorded = 0; }
+
+private:
+	std::array<TraceEntry, Capacity> m_entries{};
+	std::uint64_t m_recorded = 0;
+};
+
+#pragma endregion
+
+////////////////////////////////////////////////////
+#pragma region [Definitions (private)]
+
+constexpr const char* toString(TraceAction action) noexcept {
+	switch (action) {
+	case TraceAction::Created: return "created";
+	case TraceAction::Rebuilt: return "rebuilt";
+	case TraceAction::Updated: return "updated";
+	case TraceAction::Skipped: return "skipped";
+	}
+	return "";
+}
+
+constexpr const char* toString(TraceReason reason) noexcept {
+	switch (reason) {
+	case TraceReason::Missing: return "missing";
+	case TraceReason::AlreadyExists: return "already exists";
+	case TraceReason::Transient: return "transient";
+	case TraceReason::Requested: return "requested";
+	case TraceReason::DependencyChanged: return "dependency changed";
+	case TraceReason::UpdateFailed: return "update failed";
+	case TraceReason::DependenciesUnchanged: return "dependencies unchanged";
+	}
+	return "";
+}
+
+template <std::size_t Capacity>
+void TraceBuffer<Capacity>::record(const TraceEntry& entry) noexcept {
+	m_entries[m_recorded % Capacity] = entry;
+	++m_recorded;
+}
+
+template <std::size_t Capacity>
+std::size_t TraceBuffer<Capacity>::size() const noexcept {
+	return m_recorded < Capacity ? static_cast<std::size_t>(m_recorded) : Capacity;
+}
+
+template <std::size_t Capacity>
+const TraceEntry& TraceBuffer<Capacity>::operator[](std::size_t k) const noexcept {
+	return m_entries[(m_recorded - size() + k) % Capacity];
+}
+
+#pragma endregion
+
+} // namespace statdeps
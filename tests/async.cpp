@@ -0,0 +1,121 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/async.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <stdexcept>
+
+/**
+ * Two resources streamed by futures that can only complete once both have
+ * started, a resource loaded by a task, and a surface that must be created on
+ * the thread blocked in syncWait() although its dependencies complete on
+ * helper threads.
+ */
+struct Context {
+	std::atomic<int> m_started{ 0 };
+
+	// Wait until both futures have started, which only happens if they overlap
+	std::future<void> stream() {
+		return std::async(std::launch::async, [this] {
+			++m_started;
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while (m_started < 2 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+	}
+
+	bool m_firstReady = false;
+	struct FirstResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_async_create<&Context::stream>
+		::with_ready_state<&Context::m_firstReady>
+		::build {};
+
+	bool m_secondReady = false;
+	struct SecondResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_async_create<&Context::stream>
+		::with_ready_state<&Context::m_secondReady>
+		::build {};
+
+	int m_loadSteps = 0;
+	bool m_failLoad = false;
+	statdeps::Task loadStep() {
+		++m_loadSteps;
+		co_return;
+	}
+	statdeps::Task load() {
+		co_await loadStep();
+		if (m_failLoad) throw std::runtime_error("Load failed");
+		co_await loadStep();
+	}
+
+	bool m_loadedReady = false;
+	struct LoadedResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_async_create<&Context::load>
+		::with_ready_state<&Context::m_loadedReady>
+		::build {};
+
+	std::thread::id m_surfaceThread;
+	void createSurface() { m_surfaceThread = std::this_thread::get_id(); }
+	bool m_surfaceReady = false;
+	struct SurfaceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createSurface>
+		::with_ready_state<&Context::m_surfaceReady>
+		::with_main_thread
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<SurfaceResource, FirstResource>,
+		statdeps::DepsEdge<SurfaceResource, SecondResource>,
+		statdeps::DepsEdge<SurfaceResource, LoadedResource>
+	>>;
+};
+
+statdeps::Task ensureSurface(Context& ctx) {
+	co_await statdeps::asyncEnsureExists(ctx, Context::SurfaceResource{}, Context::Graph{});
+}
+
+int main() {
+	{
+		Context ctx;
+		statdeps::syncWait(ensureSurface(ctx));
+		CHECK(ctx.m_firstReady && ctx.m_secondReady);
+		CHECK(ctx.m_started == 2);
+		CHECK(ctx.m_loadedReady);
+		CHECK(ctx.m_loadSteps == 2);
+		CHECK(ctx.m_surfaceReady);
+		CHECK(ctx.m_surfaceThread == std::this_thread::get_id());
+	}
+
+	// A task that throws fails syncWait(), and its dependees are not created
+	{
+		Context ctx;
+		ctx.m_failLoad = true;
+		bool thrown = false;
+		try {
+			statdeps::syncWait(statdeps::asyncEnsureExists(ctx, Context::SurfaceResource{}, Context::Graph{}));
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		CHECK(ctx.m_loadSteps == 1);
+		CHECK(!ctx.m_loadedReady);
+		CHECK(!ctx.m_surfaceReady);
+
+		// The failed resource can be retried
+		ctx.m_failLoad = false;
+		statdeps::syncWait(statdeps::asyncEnsureExists(ctx, Context::SurfaceResource{}, Context::Graph{}));
+		CHECK(ctx.m_loadedReady);
+		CHECK(ctx.m_surfaceReady);
+	}
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/batch.hpp>
+
+#include <vector>
+
+/**
+ * A device shared by all viewports, and one view per viewport that uses it.
+ * There are more viewports than a batch holds, so that the device is only
+ * replaced once the views of all batches are destroyed.
+ */
+int liveViews = 0;
+int deviceCreations = 0;
+int deviceDestructions = 0;
+bool deviceReady = false;
+
+void createDevice() {
+	CHECK(liveViews == 0);
+	++deviceCreations;
+}
+void destroyDevice() {
+	CHECK(liveViews == 0);
+	++deviceDestructions;
+}
+struct DeviceResource : statdeps::DepsNodeBuilder
+	::with_create<&createDevice>
+	::with_destroy<&destroyDevice>
+	::with_ready_state<&deviceReady>
+	::build {};
+
+struct Viewport {
+	bool m_viewReady = false;
+	int m_viewCreations = 0;
+	void createView() {
+		CHECK(deviceReady);
+		++liveViews;
+		++m_viewCreations;
+	}
+	void destroyView() { --liveViews; }
+	struct ViewResource : statdeps::DepsNodeBuilder
+		::with_context<Viewport>
+		::with_create<&Viewport::createView>
+		::with_destroy<&Viewport::destroyView>
+		::with_ready_state<&Viewport::m_viewReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<ViewResource, DeviceResource>
+	>>;
+};
+
+int main() {
+	constexpr std::size_t ViewportCount = statdeps::detail::BatchSize + 36;
+	std::vector<Viewport> viewports(ViewportCount);
+
+	statdeps::batchEnsureExists(viewports, Viewport::ViewResource{}, Viewport::Graph{});
+	CHECK(liveViews == int(ViewportCount));
+	CHECK(deviceCreations == 1);
+
+	statdeps::batchRebuild(viewports, DeviceResource{}, Viewport::Graph{});
+	CHECK(liveViews == int(ViewportCount));
+	CHECK(deviceCreations == 2);
+	CHECK(deviceDestructions == 1);
+	for (const Viewport& viewport : viewports) {
+		CHECK(viewport.m_viewReady);
+		CHECK(viewport.m_viewCreations == 2);
+	}
+	return 0;
+}
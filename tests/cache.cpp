@@ -0,0 +1,95 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+
+#include <map>
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <functional>
+
+/**
+ * An in-memory cache with the same interface as FileCache
+ */
+class MemoryCache {
+public:
+	template <typename Restore>
+	bool restore(std::uint64_t key, Restore&& restore) {
+		auto it = m_entries.find(key);
+		return it != m_entries.end() && restore(std::string_view(it->second));
+	}
+	void store(std::uint64_t key, std::string_view bytes) {
+		m_entries[key] = std::string(bytes);
+	}
+
+private:
+	std::map<std::uint64_t, std::string> m_entries;
+};
+
+/**
+ * A source text whose output is compiled into a cached shader, which is
+ * restored from the cache unless the source changed.
+ */
+struct Context {
+	MemoryCache m_cache;
+
+	std::string m_text = "a";
+	std::string m_source;
+	bool m_sourceReady = false;
+	std::string loadSource() { return m_text; }
+	std::uint64_t hashSource() { return std::hash<std::string>{}(m_source); }
+	struct SourceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_ready_state<&Context::m_sourceReady>
+		::with_output<&Context::m_source, &Context::loadSource>
+		::with_fingerprint<&Context::hashSource>
+		::build {};
+
+	std::string m_shader;
+	bool m_shaderReady = false;
+	int m_compilations = 0;
+	std::string compileShader(const std::string& source) {
+		++m_compilations;
+		return "compiled " + source;
+	}
+	std::uint64_t shaderKey() const { return 1; }
+	std::string saveShader() const { return m_shader; }
+	bool loadShader(std::string_view bytes) {
+		m_shader = std::string(bytes);
+		return true;
+	}
+	struct ShaderResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_ready_state<&Context::m_shaderReady>
+		::with_output<&Context::m_shader, &Context::compileShader>
+		::with_cache<&Context::m_cache, &Context::shaderKey, &Context::saveShader, &Context::loadShader>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<ShaderResource, SourceResource>
+	>>;
+};
+
+int main() {
+	Context ctx;
+	statdeps::ensureExists(ctx, Context::ShaderResource{}, Context::Graph{});
+	CHECK(ctx.m_shader == "compiled a");
+	CHECK(ctx.m_compilations == 1);
+
+	// Same source, restored from the cache
+	statdeps::rebuild(ctx, Context::ShaderResource{}, Context::Graph{});
+	CHECK(ctx.m_shader == "compiled a");
+	CHECK(ctx.m_compilations == 1);
+
+	// The fingerprint of the source is part of the key
+	ctx.m_text = "b";
+	statdeps::rebuild(ctx, Context::SourceResource{}, Context::Graph{});
+	CHECK(ctx.m_shader == "compiled b");
+	CHECK(ctx.m_compilations == 2);
+
+	ctx.m_text = "a";
+	statdeps::rebuild(ctx, Context::SourceResource{}, Context::Graph{});
+	CHECK(ctx.m_shader == "compiled a");
+	CHECK(ctx.m_compilations == 2);
+	return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Minimal assertion for tests, which unlike assert() is kept in release
+ * builds and reports where it failed.
+ */
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (false)
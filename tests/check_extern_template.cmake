@@ -0,0 +1,14 @@
+# Fail if the object file OBJECT defines the algorithms of a GraphPlan, which
+# an explicit instantiation declaration should have left to another one.
+execute_process(
+	COMMAND ${NM} -C ${OBJECT}
+	OUTPUT_VARIABLE symbols
+	RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "Could not list the symbols of ${OBJECT}")
+endif()
+string(REGEX MATCH " [TtWw] [^\n]*GraphPlan<[^\n]*::(ensureExistsAt|rebuildAt|isClosureReadyAt)" defined "${symbols}")
+if(defined)
+	message(FATAL_ERROR "${OBJECT} instantiates the plan:\n${defined}")
+endif()
@@ -0,0 +1,113 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/dirtyset.hpp>
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+/**
+ * A shader source with a fingerprint, compiled into a pipeline, and a
+ * uniform buffer that can be updated in place, bound by a bind group.
+ */
+struct Context {
+	std::string m_file = "a";
+	std::string m_source;
+	bool m_sourceReady = false;
+	int m_sourceLoads = 0;
+	void loadSource() {
+		++m_sourceLoads;
+		m_source = m_file;
+	}
+	std::uint64_t hashSource() { return std::hash<std::string>{}(m_source); }
+	struct SourceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::loadSource>
+		::with_ready_state<&Context::m_sourceReady>
+		::with_fingerprint<&Context::hashSource>
+		::build {};
+
+	bool m_pipelineReady = false;
+	int m_pipelineCreations = 0;
+	void createPipeline() { ++m_pipelineCreations; }
+	struct PipelineResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createPipeline>
+		::with_ready_state<&Context::m_pipelineReady>
+		::build {};
+
+	bool m_uniformsReady = false;
+	bool m_uniformsResized = false;
+	int m_uniformsCreations = 0;
+	int m_uniformsUpdates = 0;
+	void createUniforms() { ++m_uniformsCreations; }
+	bool updateUniforms() {
+		++m_uniformsUpdates;
+		return !m_uniformsResized;
+	}
+	struct UniformsResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createUniforms>
+		::with_ready_state<&Context::m_uniformsReady>
+		::with_update<&Context::updateUniforms>
+		::build {};
+
+	bool m_bindGroupReady = false;
+	int m_bindGroupCreations = 0;
+	void createBindGroup() { ++m_bindGroupCreations; }
+	struct BindGroupResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createBindGroup>
+		::with_ready_state<&Context::m_bindGroupReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<PipelineResource, SourceResource>,
+		statdeps::DepsEdge<BindGroupResource, PipelineResource>,
+		statdeps::DepsEdge<BindGroupResource, UniformsResource>
+	>>;
+};
+
+int main() {
+	Context ctx;
+	statdeps::ensureExists(ctx, Context::BindGroupResource{}, Context::Graph{});
+	CHECK(ctx.m_pipelineCreations == 1);
+	CHECK(ctx.m_bindGroupCreations == 1);
+
+	// An unchanged fingerprint stops the rebuild at the source
+	statdeps::rebuild(ctx, Context::SourceResource{}, Context::Graph{});
+	CHECK(ctx.m_sourceLoads == 2);
+	CHECK(ctx.m_pipelineCreations == 1);
+	CHECK(ctx.m_bindGroupCreations == 1);
+
+	// A changed one rebuilds the dependees
+	ctx.m_file = "b";
+	statdeps::rebuild(ctx, Context::SourceResource{}, Context::Graph{});
+	CHECK(ctx.m_sourceLoads == 3);
+	CHECK(ctx.m_pipelineCreations == 2);
+	CHECK(ctx.m_bindGroupCreations == 2);
+
+	// Same through a dirty set
+	statdeps::DirtySet<Context::Graph> dirty;
+	dirty.invalidate(Context::SourceResource{});
+	dirty.flush(ctx);
+	CHECK(ctx.m_sourceLoads == 4);
+	CHECK(ctx.m_pipelineCreations == 2);
+	CHECK(ctx.m_bindGroupCreations == 2);
+
+	// An update in place stops the rebuild too
+	statdeps::rebuild(ctx, Context::UniformsResource{}, Context::Graph{});
+	CHECK(ctx.m_uniformsUpdates == 1);
+	CHECK(ctx.m_uniformsCreations == 1);
+	CHECK(ctx.m_bindGroupCreations == 2);
+
+	// unless it falls back to creating the resource again
+	ctx.m_uniformsResized = true;
+	statdeps::rebuild(ctx, Context::UniformsResource{}, Context::Graph{});
+	CHECK(ctx.m_uniformsUpdates == 2);
+	CHECK(ctx.m_uniformsCreations == 2);
+	CHECK(ctx.m_bindGroupCreations == 3);
+	CHECK(ctx.m_pipelineCreations == 2);
+	return 0;
+}
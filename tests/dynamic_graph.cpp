@@ -0,0 +1,105 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/dynamicgraph.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * Nodes of the dynamic graph log their creation (+name) and destruction
+ * (-name), and static nodes around it do the same.
+ */
+struct Context {
+	std::vector<std::string> m_log;
+	statdeps::DynamicDepsGraph<Context> m_assets;
+
+	static void createAsset(Context& ctx, void* user) { ctx.m_log.push_back("+" + *static_cast<std::string*>(user)); }
+	static void destroyAsset(Context& ctx, void* user) { ctx.m_log.push_back("-" + *static_cast<std::string*>(user)); }
+
+	bool m_deviceReady = false;
+	void createDevice() { m_log.push_back("+device"); }
+	void destroyDevice() { m_log.push_back("-device"); }
+	struct DeviceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createDevice>
+		::with_destroy<&Context::destroyDevice>
+		::with_ready_state<&Context::m_deviceReady>
+		::build {};
+
+	using AssetsResource = statdeps::DynamicSubgraphNode<Context, &Context::m_assets>;
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<AssetsResource, DeviceResource>
+	>>;
+
+	statdeps::DynamicNode<Context> asset(std::string& name) {
+		return { &createAsset, &destroyAsset, nullptr, &name };
+	}
+
+	std::vector<std::string> takeLog() {
+		std::vector<std::string> log;
+		log.swap(m_log);
+		return log;
+	}
+};
+
+using Log = std::vector<std::string>;
+
+int main() {
+	Context ctx;
+	std::string a = "a", b = "b", c = "c";
+	auto& graph = ctx.m_assets;
+	auto na = graph.addNode(ctx.asset(a));
+	auto nb = graph.addNode(ctx.asset(b));
+	auto nc = graph.addNode(ctx.asset(c));
+
+	// c is positioned after a, so adding this edge reorders them
+	CHECK(graph.addEdge(na, nc));
+	CHECK(graph.addEdge(nb, na));
+	CHECK(graph.nodeCount() == 3);
+
+	// Edges that would close a cycle are refused and leave the graph as is
+	CHECK(!graph.addEdge(nc, nb));
+	CHECK(!graph.addEdge(nc, nc));
+	CHECK(graph.addEdge(nb, na));
+
+	graph.ensureExists(ctx, na);
+	CHECK((ctx.takeLog() == Log{ "+c", "+a" }));
+	CHECK(!graph.exists(ctx, nb));
+
+	graph.ensureExists(ctx, nb);
+	CHECK((ctx.takeLog() == Log{ "+b" }));
+
+	// Dependees are destroyed before and recreated after their dependencies
+	graph.rebuild(ctx, nc);
+	CHECK((ctx.takeLog() == Log{ "-b", "-a", "-c", "+c", "+a", "+b" }));
+
+	// Only dependees that existed are recreated
+	graph.destroy(ctx, nb);
+	ctx.takeLog();
+	graph.rebuild(ctx, na);
+	CHECK((ctx.takeLog() == Log{ "-a", "+a" }));
+
+	// Removing a node destroys its dependees, and its identifier is reused
+	graph.ensureExists(ctx, nb);
+	graph.removeNode(ctx, na);
+	CHECK((ctx.takeLog() == Log{ "+b", "-b", "-a" }));
+	CHECK(graph.nodeCount() == 2);
+	std::string d = "d";
+	auto nd = graph.addNode(ctx.asset(d));
+	CHECK(nd == na);
+	CHECK(graph.addEdge(nd, nb));
+	CHECK(graph.addEdge(nb, nc));
+	graph.ensureExists(ctx, nd);
+	CHECK((ctx.takeLog() == Log{ "+b", "+d" }));
+
+	// The whole dynamic graph is a single node of the static graph
+	graph.destroyAll(ctx);
+	ctx.takeLog();
+	statdeps::ensureExists(ctx, Context::AssetsResource{}, Context::Graph{});
+	CHECK((ctx.takeLog() == Log{ "+device", "+c", "+b", "+d" }));
+	statdeps::rebuild(ctx, Context::DeviceResource{}, Context::Graph{});
+	CHECK((ctx.takeLog() == Log{ "-d", "-b", "-c", "-device", "+device", "+c", "+b", "+d" }));
+	return 0;
+}
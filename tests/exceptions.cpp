@@ -0,0 +1,92 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/oncestate.hpp>
+#include <statdeps/dirtyset.hpp>
+#include <statdeps/instrumentation.hpp>
+
+#include <stdexcept>
+
+/**
+ * Exceptions thrown by create callbacks go through ensureExists() and
+ * rebuild(), leaving the failed resource absent so that it can be retried.
+ */
+struct Context {
+	int m_failures = 0;
+
+	statdeps::OnceState m_deviceState;
+	void createDevice() {
+		if (m_failures > 0) {
+			--m_failures;
+			throw std::runtime_error("Device lost");
+		}
+	}
+	struct DeviceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createDevice>
+		::with_once_state<&Context::m_deviceState>
+		::with_instrumentation<statdeps::CountingInstrumentation>
+		::build {};
+
+	bool m_textureReady = false;
+	int m_textureCreations = 0;
+	void createTexture() { ++m_textureCreations; }
+	struct TextureResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createTexture>
+		::with_ready_state<&Context::m_textureReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<TextureResource, DeviceResource>
+	>>;
+};
+
+template <typename Function>
+bool throws(Function&& function) {
+	try {
+		function();
+	}
+	catch (const std::runtime_error&) {
+		return true;
+	}
+	return false;
+}
+
+int main() {
+	using Counters = statdeps::CountingInstrumentation;
+	auto& counters = Counters::counters<Context::DeviceResource>();
+	Context ctx;
+
+	ctx.m_failures = 1;
+	CHECK(throws([&ctx]() { statdeps::ensureExists(ctx, Context::TextureResource{}, Context::Graph{}); }));
+	CHECK(ctx.m_deviceState.load() == statdeps::OnceState::Value::Absent);
+	CHECK(!ctx.m_textureReady);
+
+	// The policy is notified of the end of the failed creation too
+	CHECK(counters.creations == 1);
+
+	CHECK(!throws([&ctx]() { statdeps::ensureExists(ctx, Context::TextureResource{}, Context::Graph{}); }));
+	CHECK(ctx.m_deviceState.load() == statdeps::OnceState::Value::Ready);
+	CHECK(ctx.m_textureCreations == 1);
+	CHECK(counters.creations == 2);
+
+	ctx.m_failures = 1;
+	CHECK(throws([&ctx]() { statdeps::rebuild(ctx, Context::DeviceResource{}, Context::Graph{}); }));
+	CHECK(!ctx.m_deviceState);
+	CHECK(counters.creations == 3);
+
+	// A flush that fails keeps the invalidated nodes for the next one
+	statdeps::DirtySet<Context::Graph> dirty;
+	dirty.invalidate(Context::DeviceResource{});
+	ctx.m_failures = 1;
+	CHECK(throws([&]() { dirty.flush(ctx); }));
+	CHECK(dirty.isDirty(Context::DeviceResource{}));
+	CHECK(counters.creations == 4);
+
+	CHECK(!throws([&]() { dirty.flush(ctx); }));
+	CHECK(dirty.empty());
+	CHECK(ctx.m_deviceState.load() == statdeps::OnceState::Value::Ready);
+	CHECK(counters.creations == 5);
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/lazy.hpp>
+
+/**
+ * A texture created from a device, whose value tells which generation of the
+ * device it was created from.
+ */
+struct Context {
+	int m_device = 0;
+	bool m_deviceReady = false;
+	void createDevice() { ++m_device; }
+	struct DeviceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createDevice>
+		::with_ready_state<&Context::m_deviceReady>
+		::build {};
+
+	int m_texture = 0;
+	int m_textureCreations = 0;
+	bool m_textureReady = false;
+	void createTexture() {
+		++m_textureCreations;
+		m_texture = 10 * m_device;
+	}
+	struct TextureResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createTexture>
+		::with_ready_state<&Context::m_textureReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<TextureResource, DeviceResource>
+	>>;
+
+	using LazyTexture = statdeps::Lazy<TextureResource, Graph, &Context::m_texture>;
+};
+
+int main() {
+	Context ctx;
+	CHECK(statdeps::get<Context::LazyTexture>(ctx) == 10);
+	CHECK(ctx.m_textureCreations == 1);
+
+	// Getting an existing resource creates nothing
+	CHECK(statdeps::get<Context::LazyTexture>(ctx) == 10);
+	CHECK(ctx.m_textureCreations == 1);
+
+	// A lazy rebuild only destroys, and the next access creates again
+	statdeps::rebuildLazily(ctx, Context::DeviceResource{}, Context::Graph{});
+	CHECK(!ctx.m_deviceReady && !ctx.m_textureReady);
+	CHECK(ctx.m_device == 1);
+	CHECK(ctx.m_textureCreations == 1);
+
+	CHECK(statdeps::get<Context::LazyTexture>(ctx) == 20);
+	CHECK(ctx.m_deviceReady && ctx.m_textureReady);
+	CHECK(ctx.m_textureCreations == 2);
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * A texture streamed in 4 levels, a view that can start with the first one
+ * and statistics that need the complete texture.
+ */
+struct Context {
+	std::uint8_t m_textureLevel = 0;
+	int m_textureCreations = 0;
+	std::vector<std::size_t> m_refinedLevels;
+	void createTexture() { ++m_textureCreations; }
+	void refineTexture(std::size_t level) { m_refinedLevels.push_back(level); }
+	struct TextureResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createTexture>
+		::with_levels<&Context::m_textureLevel, 4, &Context::refineTexture>
+		::build {};
+
+	bool m_viewReady = false;
+	std::uint8_t m_levelSeenByView = 0;
+	void createView() { m_levelSeenByView = m_textureLevel; }
+	struct ViewResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createView>
+		::with_ready_state<&Context::m_viewReady>
+		::build {};
+
+	bool m_statsReady = false;
+	std::uint8_t m_levelSeenByStats = 0;
+	void createStats() { m_levelSeenByStats = m_textureLevel; }
+	struct StatsResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createStats>
+		::with_ready_state<&Context::m_statsReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<ViewResource, TextureResource, 1>,
+		statdeps::DepsEdge<StatsResource, TextureResource>
+	>>;
+};
+
+int main() {
+	// The view starts with the first level only
+	{
+		Context ctx;
+		statdeps::ensureExists(ctx, Context::ViewResource{}, Context::Graph{});
+		CHECK(ctx.m_viewReady);
+		CHECK(ctx.m_textureCreations == 1);
+		CHECK(ctx.m_textureLevel == 1);
+		CHECK(ctx.m_levelSeenByView == 1);
+		CHECK(ctx.m_refinedLevels.empty());
+
+		// refine() raises one level at a time and tells when it is complete
+		CHECK(!statdeps::refine(ctx, Context::TextureResource{}, Context::Graph{}));
+		CHECK(!statdeps::refine(ctx, Context::TextureResource{}, Context::Graph{}));
+		CHECK(statdeps::refine(ctx, Context::TextureResource{}, Context::Graph{}));
+		CHECK(ctx.m_textureLevel == 4);
+		CHECK((ctx.m_refinedLevels == std::vector<std::size_t>{ 2, 3, 4 }));
+
+		// A complete resource is not refined any further
+		CHECK(statdeps::refine(ctx, Context::TextureResource{}, Context::Graph{}));
+		CHECK(ctx.m_refinedLevels.size() == 3);
+
+		// Nor is a missing one
+		Context empty;
+		CHECK(!statdeps::refine(empty, Context::TextureResource{}, Context::Graph{}));
+		CHECK(empty.m_refinedLevels.empty());
+	}
+
+	// The statistics refine the texture up to the last level first
+	{
+		Context ctx;
+		statdeps::ensureExists(ctx, Context::ViewResource{}, Context::Graph{});
+		statdeps::ensureExists(ctx, Context::StatsResource{}, Context::Graph{});
+		CHECK(ctx.m_statsReady);
+		CHECK(ctx.m_textureCreations == 1);
+		CHECK(ctx.m_levelSeenByStats == 4);
+		CHECK((ctx.m_refinedLevels == std::vector<std::size_t>{ 2, 3, 4 }));
+	}
+	return 0;
+}
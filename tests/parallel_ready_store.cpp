@@ -0,0 +1,47 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/parallel.hpp>
+
+#include <utility>
+
+/**
+ * Independent nodes that share a word of a ReadyStore are created by
+ * different workers, which must not overwrite each other's bits.
+ */
+struct Context {
+	statdeps::ReadyStore<> m_readyStates;
+
+	template <int N>
+	void create() {}
+
+	template <int N>
+	struct Resource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::create<N>>
+		::with_ready_store<&Context::m_readyStates>
+		::build {};
+
+	struct Root : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::create<-1>>
+		::with_ready_store<&Context::m_readyStates>
+		::build {};
+
+};
+
+template <int... Ns>
+statdeps::DepsGraph<statdeps::List<>, statdeps::List<statdeps::DepsEdge<Context::Root, Context::Resource<Ns>>...>> makeGraph(std::integer_sequence<int, Ns...>);
+
+using Graph = decltype(makeGraph(std::make_integer_sequence<int, 12>{}));
+
+int main() {
+	statdeps::ThreadPool pool(8);
+	Context ctx;
+	for (int run = 0; run < 20000; ++run) {
+		ctx.m_readyStates.clear();
+		statdeps::parallelEnsureExists(ctx, Context::Root{}, Graph{}, pool);
+		CHECK(statdeps::isClosureReady(ctx, Context::Root{}, Graph{}));
+	}
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include "check.hpp"
+#include "plan_graph.hpp"
+
+/**
+ * Only the tables of the graph are evaluated here, the algorithms of the plan
+ * are instantiated in plan_graph.cpp.
+ */
+using Plan = statdeps::GraphPlan<Application, Application::Graph>;
+using Tables = Application::Graph::Tables;
+
+// The shared node is a single node of the joined graph
+static_assert(Tables::NodeCount == 4);
+static_assert(Tables::template IndexOf<Application::DeviceResource> == 0);
+
+int main() {
+	Application app;
+	CHECK(!Plan::isClosureReady(app, Application::FrameResource{}));
+
+	Plan::ensureExists(app, Application::FrameResource{});
+	CHECK(Plan::isClosureReady(app, Application::FrameResource{}));
+	CHECK(app.m_deviceCreations == 1);
+	CHECK(app.m_queueCreations == 1);
+	CHECK(app.m_pipelineCreations == 1);
+	CHECK(app.m_frameCreations == 1);
+
+	// The duplicated edge does not rebuild the queue twice
+	Plan::rebuildAt(app, Tables::template IndexOf<Application::DeviceResource>);
+	CHECK(app.m_deviceDestructions == 1);
+	CHECK(app.m_deviceCreations == 2);
+	CHECK(app.m_queueCreations == 2);
+	CHECK(app.m_pipelineCreations == 2);
+	CHECK(app.m_frameCreations == 2);
+	return 0;
+}
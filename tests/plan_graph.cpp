@@ -0,0 +1,9 @@
+#include "plan_graph.hpp"
+
+void Application::createDevice() { ++m_deviceCreations; }
+void Application::destroyDevice() { ++m_deviceDestructions; }
+void Application::createQueue() { ++m_queueCreations; }
+void Application::createPipeline() { ++m_pipelineCreations; }
+void Application::createFrame() { ++m_frameCreations; }
+
+template class statdeps::GraphPlan<Application, Application::Graph>;
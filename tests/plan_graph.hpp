@@ -0,0 +1,66 @@
+#pragma once
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/plan.hpp>
+
+/**
+ * A graph joined from a device subgraph and a pipeline subgraph, which share
+ * the device node and both declare the Queue -> Device edge, and whose plan
+ * is built in plan_graph.cpp only.
+ */
+struct Application {
+	int m_deviceCreations = 0;
+	int m_deviceDestructions = 0;
+	bool m_deviceReady = false;
+	void createDevice();
+	void destroyDevice();
+	struct DeviceResource : statdeps::DepsNodeBuilder
+		::with_context<Application>
+		::with_create<&Application::createDevice>
+		::with_destroy<&Application::destroyDevice>
+		::with_ready_state<&Application::m_deviceReady>
+		::build {};
+
+	int m_queueCreations = 0;
+	bool m_queueReady = false;
+	void createQueue();
+	struct QueueResource : statdeps::DepsNodeBuilder
+		::with_context<Application>
+		::with_create<&Application::createQueue>
+		::with_ready_state<&Application::m_queueReady>
+		::build {};
+
+	int m_pipelineCreations = 0;
+	bool m_pipelineReady = false;
+	void createPipeline();
+	struct PipelineResource : statdeps::DepsNodeBuilder
+		::with_context<Application>
+		::with_create<&Application::createPipeline>
+		::with_ready_state<&Application::m_pipelineReady>
+		::build {};
+
+	int m_frameCreations = 0;
+	bool m_frameReady = false;
+	void createFrame();
+	struct FrameResource : statdeps::DepsNodeBuilder
+		::with_context<Application>
+		::with_create<&Application::createFrame>
+		::with_ready_state<&Application::m_frameReady>
+		::build {};
+
+	using DeviceGraph = statdeps::DepsGraph<statdeps::List<DeviceResource>, statdeps::List<
+		statdeps::DepsEdge<QueueResource, DeviceResource>
+	>>;
+
+	using PipelineGraph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<PipelineResource, DeviceResource>,
+		statdeps::DepsEdge<QueueResource, DeviceResource>
+	>>;
+
+	using Graph = statdeps::JoinGraphs<DeviceGraph, PipelineGraph, statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<FrameResource, PipelineResource>,
+		statdeps::DepsEdge<FrameResource, QueueResource>
+	>>>;
+};
+
+extern template class statdeps::GraphPlan<Application, Application::Graph>;
@@ -0,0 +1,100 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/rebuildjob.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+/**
+ * A chain Device <- Texture <- View where the view does not exist, and where
+ * operations are logged to check what each step does.
+ */
+struct Context {
+	std::vector<std::string> m_log;
+	int m_textureFailures = 0;
+
+	bool m_deviceReady = false;
+	void createDevice() { m_log.push_back("create device"); }
+	void destroyDevice() { m_log.push_back("destroy device"); }
+	struct DeviceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createDevice>
+		::with_destroy<&Context::destroyDevice>
+		::with_ready_state<&Context::m_deviceReady>
+		::build {};
+
+	bool m_textureReady = false;
+	void createTexture() {
+		if (m_textureFailures > 0) {
+			--m_textureFailures;
+			throw std::runtime_error("Out of memory");
+		}
+		m_log.push_back("create texture");
+	}
+	void destroyTexture() { m_log.push_back("destroy texture"); }
+	struct TextureResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createTexture>
+		::with_destroy<&Context::destroyTexture>
+		::with_ready_state<&Context::m_textureReady>
+		::build {};
+
+	bool m_viewReady = false;
+	void createView() { m_log.push_back("create view"); }
+	struct ViewResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createView>
+		::with_ready_state<&Context::m_viewReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<TextureResource, DeviceResource>,
+		statdeps::DepsEdge<ViewResource, TextureResource>
+	>>;
+};
+
+int main() {
+	Context ctx;
+	statdeps::ensureExists(ctx, Context::TextureResource{}, Context::Graph{});
+	ctx.m_log.clear();
+
+	auto job = statdeps::beginRebuild(ctx, Context::DeviceResource{}, Context::Graph{});
+	static_assert(decltype(job)::StepCount == 6);
+	CHECK(ctx.m_log.empty());
+
+	// A budget of zero still runs one step, here destroying the missing view
+	CHECK(!job.step(ctx, std::chrono::nanoseconds(0)));
+	CHECK(job.completedSteps() == 1);
+	CHECK(ctx.m_log.empty());
+
+	job.step(ctx);
+	job.step(ctx);
+	CHECK(job.completedSteps() == 3);
+	CHECK((ctx.m_log == std::vector<std::string>{ "destroy texture", "destroy device" }));
+	CHECK(!ctx.m_deviceReady && !ctx.m_textureReady);
+
+	// A step that throws is retried by the next call
+	job.step(ctx);
+	ctx.m_textureFailures = 1;
+	bool thrown = false;
+	try {
+		job.step(ctx);
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(job.completedSteps() == 4);
+	CHECK(!ctx.m_textureReady);
+
+	job.finish(ctx);
+	CHECK(job.done());
+	CHECK(job.progress() == 1.0f);
+	CHECK((ctx.m_log == std::vector<std::string>{ "destroy texture", "destroy device", "create device", "create texture" }));
+	CHECK(ctx.m_deviceReady && ctx.m_textureReady);
+	CHECK(!ctx.m_viewReady);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/pool.hpp>
+
+#include <vector>
+
+/**
+ * A resource that can be neither copied nor moved, so that a pool can only
+ * hold it if it is constructed in place.
+ */
+struct Texture {
+	explicit Texture(int size) : size(size) {}
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	int size;
+};
+
+struct Context {
+	int m_size = 16;
+	int m_viewCreations = 0;
+	int m_textureDestructions = 0;
+
+	// Shared by all contexts, while each of them has its own handle
+	static inline statdeps::ResourcePool<Texture, 4> s_textures;
+	statdeps::Handle<Texture> m_texture;
+
+	Texture makeTexture() { return Texture(m_size); }
+	void destroyTexture() { ++m_textureDestructions; }
+	struct TextureResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_destroy<&Context::destroyTexture>
+		::with_pool<&Context::s_textures, &Context::m_texture, &Context::makeTexture>
+		::build {};
+
+	bool m_viewReady = false;
+	void createView() {
+		CHECK(s_textures.get(m_texture) != nullptr);
+		++m_viewCreations;
+	}
+	struct ViewResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createView>
+		::with_ready_state<&Context::m_viewReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<ViewResource, TextureResource>
+	>>;
+};
+
+int main() {
+	{
+		// Handles of released resources are invalid even once their slot is reused
+		statdeps::ResourcePool<Texture, 4> pool;
+		auto first = pool.emplace(1);
+		auto second = pool.emplace(2);
+		CHECK(pool.size() == 2);
+		CHECK(pool.get(first)->size == 1);
+		pool.release(first);
+		CHECK(pool.get(first) == nullptr);
+		auto third = pool.emplace(3);
+		CHECK(third.index == first.index);
+		CHECK(third != first);
+		CHECK(pool.get(first) == nullptr);
+		CHECK(pool.get(third)->size == 3);
+		CHECK(!pool.contains(statdeps::Handle<Texture>{}));
+		pool.release(second);
+		pool.release(third);
+		CHECK(pool.size() == 0);
+	}
+
+	std::vector<Context> contexts(10);
+	for (std::size_t i = 0; i < contexts.size(); ++i) {
+		contexts[i].m_size = static_cast<int>(i);
+	}
+	statdeps::batchEnsureExists(contexts, Context::ViewResource{}, Context::Graph{});
+	CHECK(Context::s_textures.size() == contexts.size());
+	for (std::size_t i = 0; i < contexts.size(); ++i) {
+		CHECK(Context::s_textures.get(contexts[i].m_texture)->size == static_cast<int>(i));
+		CHECK(contexts[i].m_viewCreations == 1);
+	}
+
+	// Rebuilding gives the slot back to the pool and takes it again
+	Context& ctx = contexts[3];
+	const statdeps::Handle<Texture> before = ctx.m_texture;
+	ctx.m_size = 42;
+	statdeps::rebuild(ctx, Context::TextureResource{}, Context::Graph{});
+	CHECK(ctx.m_textureDestructions == 1);
+	CHECK(ctx.m_viewCreations == 2);
+	CHECK(Context::s_textures.get(before) == nullptr);
+	CHECK(ctx.m_texture.index == before.index);
+	CHECK(Context::s_textures.get(ctx.m_texture)->size == 42);
+	CHECK(Context::s_textures.size() == contexts.size());
+
+	statdeps::destroyResource(ctx, Context::TextureResource{});
+	CHECK(!ctx.m_texture);
+	CHECK(Context::s_textures.size() == contexts.size() - 1);
+	return 0;
+}
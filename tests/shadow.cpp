@@ -0,0 +1,113 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/shadow.hpp>
+#include <statdeps/instrumentation.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * A chain Source <- Pipeline <- Frame of outputs, where destroy callbacks log
+ * the output they see, so that the generation they run on can be checked.
+ */
+struct Context {
+	std::vector<std::string> m_log;
+	int m_version = 1;
+
+	std::string m_source;
+	bool m_sourceReady = false;
+	std::string loadSource() { return "source" + std::to_string(m_version); }
+	void destroySource() { m_log.push_back("destroy " + m_source); }
+	struct SourceResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_output<&Context::m_source, &Context::loadSource>
+		::with_destroy<&Context::destroySource>
+		::with_ready_state<&Context::m_sourceReady>
+		::build {};
+
+	std::string m_pipeline;
+	bool m_pipelineReady = false;
+	std::string makePipeline(const std::string& source) { return "pipeline(" + source + ")"; }
+	void destroyPipeline() { m_log.push_back("destroy " + m_pipeline); }
+	struct PipelineResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_output<&Context::m_pipeline, &Context::makePipeline>
+		::with_destroy<&Context::destroyPipeline>
+		::with_ready_state<&Context::m_pipelineReady>
+		::with_instrumentation<statdeps::CountingInstrumentation>
+		::build {};
+
+	std::string m_frame;
+	bool m_frameReady = false;
+	int m_frameCreations = 0;
+	std::string makeFrame(const std::string& pipeline) {
+		++m_frameCreations;
+		return "frame(" + pipeline + ")";
+	}
+	struct FrameResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_output<&Context::m_frame, &Context::makeFrame>
+		::with_ready_state<&Context::m_frameReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<PipelineResource, SourceResource>,
+		statdeps::DepsEdge<FrameResource, PipelineResource>
+	>>;
+};
+
+int main() {
+	auto& counters = statdeps::CountingInstrumentation::counters<Context::PipelineResource>();
+
+	// The frame does not exist, so it is not created by the rebuild
+	{
+		Context ctx;
+		statdeps::ensureExists(ctx, Context::PipelineResource{}, Context::Graph{});
+		CHECK(ctx.m_pipeline == "pipeline(source1)");
+		CHECK(counters.creations == 1);
+
+		ctx.m_version = 2;
+		auto job = statdeps::beginShadowedRebuild(ctx, Context::SourceResource{}, Context::Graph{});
+
+		// New outputs are created beside the old ones, which stay readable
+		while (job.completedSteps() < 3) job.step(ctx);
+		CHECK(!job.swapped());
+		CHECK(ctx.m_source == "source1");
+		CHECK(ctx.m_pipeline == "pipeline(source1)");
+		CHECK(ctx.m_log.empty());
+
+		job.step(ctx);
+		CHECK(job.swapped());
+		CHECK(ctx.m_source == "source2");
+		CHECK(ctx.m_pipeline == "pipeline(source2)");
+		CHECK(ctx.m_log.empty());
+
+		// Old outputs are destroyed from the last one to the first one
+		job.finish(ctx);
+		CHECK(job.done());
+		CHECK(ctx.m_log.size() == 2);
+		CHECK(ctx.m_log[0] == "destroy pipeline(source1)");
+		CHECK(ctx.m_log[1] == "destroy source1");
+		CHECK(ctx.m_source == "source2");
+		CHECK(ctx.m_pipeline == "pipeline(source2)");
+
+		CHECK(!ctx.m_frameReady);
+		CHECK(ctx.m_frameCreations == 0);
+
+		// Shadowed creations and destructions are instrumented too
+		CHECK(counters.creations == 2);
+		CHECK(counters.destructions == 1);
+	}
+
+	// A root that did not exist is created and marked ready
+	{
+		Context ctx;
+		statdeps::rebuildShadowed(ctx, Context::SourceResource{}, Context::Graph{});
+		CHECK(ctx.m_sourceReady);
+		CHECK(ctx.m_source == "source1");
+		CHECK(ctx.m_log.empty());
+		CHECK(!ctx.m_pipelineReady);
+	}
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+#include <statdeps/trace.hpp>
+
+/**
+ * A chain Path <- Texture <- View where Path and View are traced, and where
+ * the view does not exist, so that rebuilding the path skips it.
+ */
+struct Context {
+	statdeps::TraceBuffer<> m_trace;
+
+	void create() {}
+
+	bool m_pathReady = false;
+	struct PathResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::create>
+		::with_ready_state<&Context::m_pathReady>
+		::with_trace<&Context::m_trace>
+		::build {};
+
+	bool m_textureReady = false;
+	struct TextureResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::create>
+		::with_ready_state<&Context::m_textureReady>
+		::with_trace<&Context::m_trace>
+		::build {};
+
+	bool m_viewReady = false;
+	struct ViewResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::create>
+		::with_ready_state<&Context::m_viewReady>
+		::with_trace<&Context::m_trace>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<TextureResource, PathResource>,
+		statdeps::DepsEdge<ViewResource, TextureResource>
+	>>;
+};
+
+bool matches(const statdeps::TraceEntry& entry, std::size_t node, statdeps::TraceAction action, statdeps::TraceReason reason) {
+	return entry.node == node && entry.action == action && entry.reason == reason;
+}
+
+// The three entries of rebuilding the path, in topological order
+bool recordedRebuild(const statdeps::TraceBuffer<>& trace) {
+	using Tables = Context::Graph::Tables;
+	using statdeps::TraceAction;
+	using statdeps::TraceReason;
+	return trace.size() == 3
+		&& matches(trace[0], Tables::IndexOf<Context::PathResource>, TraceAction::Rebuilt, TraceReason::Requested)
+		&& matches(trace[1], Tables::IndexOf<Context::TextureResource>, TraceAction::Rebuilt, TraceReason::DependencyChanged)
+		&& matches(trace[2], Tables::IndexOf<Context::ViewResource>, TraceAction::Skipped, TraceReason::Missing);
+}
+
+int main() {
+	Context ctx;
+	statdeps::ensureExists(ctx, Context::TextureResource{}, Context::Graph{});
+	ctx.m_trace.clear();
+
+	statdeps::rebuild(ctx, Context::PathResource{}, Context::Graph{});
+	CHECK(recordedRebuild(ctx.m_trace));
+	ctx.m_trace.clear();
+
+	statdeps::DirtySet<Context::Graph> dirty;
+	dirty.invalidate(Context::PathResource{});
+	dirty.flush(ctx);
+	CHECK(recordedRebuild(ctx.m_trace));
+	ctx.m_trace.clear();
+
+	auto job = statdeps::beginRebuild(ctx, Context::PathResource{}, Context::Graph{});
+	job.finish(ctx);
+	CHECK(recordedRebuild(ctx.m_trace));
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include "check.hpp"
+
+#include <statdeps/statdeps.hpp>
+
+/**
+ * Pixels read from a file, only needed to create the two textures filled
+ * from them.
+ */
+struct Context {
+	bool m_pixelsReady = false;
+	int m_pixelsCreations = 0;
+	int m_pixelsDestructions = 0;
+	void createPixels() { ++m_pixelsCreations; }
+	void destroyPixels() { ++m_pixelsDestructions; }
+	struct PixelsResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createPixels>
+		::with_destroy<&Context::destroyPixels>
+		::with_ready_state<&Context::m_pixelsReady>
+		::with_transient
+		::build {};
+
+	bool m_colorReady = false;
+	bool m_pixelsSeenByColor = false;
+	void createColor() { m_pixelsSeenByColor = m_pixelsReady; }
+	struct ColorResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createColor>
+		::with_ready_state<&Context::m_colorReady>
+		::build {};
+
+	bool m_normalReady = false;
+	bool m_pixelsSeenByNormal = false;
+	void createNormal() { m_pixelsSeenByNormal = m_pixelsReady; }
+	struct NormalResource : statdeps::DepsNodeBuilder
+		::with_context<Context>
+		::with_create<&Context::createNormal>
+		::with_ready_state<&Context::m_normalReady>
+		::build {};
+
+	using Graph = statdeps::DepsGraph<statdeps::List<>, statdeps::List<
+		statdeps::DepsEdge<ColorResource, PixelsResource>,
+		statdeps::DepsEdge<NormalResource, PixelsResource>
+	>>;
+};
+
+int main() {
+	Context ctx;
+
+	// The pixels are kept while the normal texture may still need them
+	statdeps::ensureExists(ctx, Context::ColorResource{}, Context::Graph{});
+	CHECK(ctx.m_colorReady && ctx.m_pixelsSeenByColor);
+	CHECK(ctx.m_pixelsReady);
+	CHECK(ctx.m_pixelsCreations == 1);
+
+	// and released once the last dependee exists
+	statdeps::ensureExists(ctx, Context::NormalResource{}, Context::Graph{});
+	CHECK(ctx.m_normalReady && ctx.m_pixelsSeenByNormal);
+	CHECK(!ctx.m_pixelsReady);
+	CHECK(ctx.m_pixelsCreations == 1);
+	CHECK(ctx.m_pixelsDestructions == 1);
+
+	// Rebuilding the pixels creates them again for the dependees only
+	statdeps::rebuild(ctx, Context::PixelsResource{}, Context::Graph{});
+	CHECK(ctx.m_colorReady && ctx.m_normalReady);
+	CHECK(ctx.m_pixelsSeenByColor && ctx.m_pixelsSeenByNormal);
+	CHECK(!ctx.m_pixelsReady);
+	CHECK(ctx.m_pixelsCreations == 2);
+	CHECK(ctx.m_pixelsDestructions == 2);
+
+	// A released transient node is created again when a dependee needs it
+	statdeps::rebuild(ctx, Context::ColorResource{}, Context::Graph{});
+	CHECK(ctx.m_colorReady && ctx.m_pixelsSeenByColor);
+	CHECK(!ctx.m_pixelsReady);
+	CHECK(ctx.m_pixelsCreations == 3);
+	CHECK(ctx.m_pixelsDestructions == 3);
+	return 0;
+}